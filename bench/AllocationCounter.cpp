@@ -0,0 +1,41 @@
+#include "AllocationCounter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+    std::atomic<uint64_t> allocations(0);
+}
+
+uint64_t AllocationCount() {
+    return allocations.load(std::memory_order_relaxed);
+}
+
+void *operator new(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept {
+    std::free(p);
+}
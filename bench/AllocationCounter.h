@@ -0,0 +1,7 @@
+#pragma once
+
+#include <cstdint>
+
+/// Calls to the global operator new since the program started, from every thread.
+/// Linking AllocationCounter.cpp replaces the global allocation functions to count them.
+uint64_t AllocationCount();
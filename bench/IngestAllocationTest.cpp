@@ -0,0 +1,127 @@
+#include "AllocationCounter.h"
+#include "ModuleManager.h"
+#include "Schema.h"
+
+#include "amm/BaseLogger.h"
+
+#include <sqlite3.h>
+
+#include <cstdio>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+
+namespace {
+    const int Modules = 4;
+
+    /// Samples of each topic delivered per module before counting starts.
+    const int WarmupRounds = 64;
+
+    const int MeasuredRounds = 256;
+
+    bool ResetDatabase() {
+        remove("amm.db");
+        remove("amm.db-wal");
+        remove("amm.db-shm");
+        sqlite3 *db = nullptr;
+        bool ok = sqlite3_open("amm.db", &db) == SQLITE_OK && AMM::CreateTables(db);
+        sqlite3_close(db);
+        return ok;
+    }
+
+    SampleInfo_t MakeInfo(int module) {
+        SampleInfo_t info;
+        GUID_t guid;
+        guid.guidPrefix.value[0] = 0x01;
+        guid.guidPrefix.value[GuidPrefix_t::size - 1] = static_cast<octet>(module);
+        info.sample_identity.writer_guid(guid);
+        return info;
+    }
+
+    struct Samples {
+        AMM::EventRecord record;
+        AMM::RenderModification render;
+        AMM::Log log;
+    };
+
+    Samples MakeSamples(int round) {
+        Samples samples;
+        AMM::UUID id;
+        id.id("00000000-0000-0000-0000-" + to_string(100000000000ULL + round));
+        samples.record.id(id);
+        samples.record.timestamp(static_cast<uint64_t>(round));
+        samples.record.type("PATIENT_ACTION");
+        AMM::FMA_Location location;
+        location.name("right_forearm");
+        location.FMAID("9740");
+        samples.record.location(location);
+        samples.record.data("<data tourniquet=\"applied\" location=\"right_forearm\" fmaid=\"9740\"/>");
+
+        samples.render.event_id(id);
+        samples.render.type("BLEEDING");
+        samples.render.data("<RenderModification type=\"BLEEDING\" rate=\"" + to_string(round % 100) + "\"/>");
+
+        samples.log.timestamp(static_cast<uint64_t>(round));
+        samples.log.level(AMM::LogLevel::L_INFO);
+        samples.log.message("Allocation test log line " + to_string(round) + " with enough text to leave SSO");
+        return samples;
+    }
+
+    void Deliver(AMM::ModuleManager &manager, Samples &samples, vector<SampleInfo_t> &infos) {
+        for (SampleInfo_t &info : infos) {
+            manager.Bus().Deliver(samples.record, info);
+            manager.Bus().Deliver(samples.render, info);
+            manager.Bus().Deliver(samples.log, info);
+        }
+    }
+}
+
+/// Checks that a steady-state sample costs no heap allocation anywhere on the listener path:
+/// the mock bus delivers warmed-up EventRecord, RenderModification and Log samples through
+/// onNewSample, the topic traits, the module registry, metrics and latency tracking, and
+/// every operator new from any thread while they are delivered fails the test.
+int main() {
+    static plog::ColorConsoleAppender <plog::TxtFormatter> consoleAppender;
+    plog::init(plog::warning, &consoleAppender);
+
+    if (!ResetDatabase()) {
+        cerr << "Unable to create amm.db" << endl;
+        return 1;
+    }
+
+    vector<Samples> warmup;
+    for (int round = 0; round < WarmupRounds; ++round) {
+        warmup.push_back(MakeSamples(round));
+    }
+    vector<Samples> measured;
+    for (int round = 0; round < MeasuredRounds; ++round) {
+        measured.push_back(MakeSamples(WarmupRounds + round));
+    }
+    vector<SampleInfo_t> infos;
+    for (int module = 1; module <= Modules; ++module) {
+        infos.push_back(MakeInfo(module));
+    }
+
+    AMM::ModuleManager manager;
+
+    // First sight of each module registers it, and the first samples size thread-local
+    // buffers, prepared statements and the event batches.
+    for (Samples &samples : warmup) {
+        Deliver(manager, samples, infos);
+    }
+
+    const uint64_t before = AllocationCount();
+    for (Samples &samples : measured) {
+        Deliver(manager, samples, infos);
+    }
+    const uint64_t allocations = AllocationCount() - before;
+
+    const uint64_t delivered = static_cast<uint64_t>(MeasuredRounds) * Modules * 3;
+    cout << "samples delivered " << delivered << ", allocations in steady state " << allocations << endl;
+    if (allocations != 0) {
+        cerr << "The listener path allocated " << allocations << " times after warm-up" << endl;
+        return 1;
+    }
+    return 0;
+}
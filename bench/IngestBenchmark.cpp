@@ -0,0 +1,251 @@
+#include "AllocationCounter.h"
+#include "ModuleManager.h"
+#include "Schema.h"
+
+#include "amm/BaseLogger.h"
+
+#include <sqlite3.h>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+
+using namespace std;
+
+namespace {
+    struct Options {
+        uint64_t events = 20000;
+        int modules = 8;
+        string directory = "amm_bench";
+    };
+
+    struct Configuration {
+        const char *name;
+        int modules;
+        bool tracing;
+    };
+
+    struct Result {
+        uint64_t delivered = 0;
+        uint64_t persisted = 0;
+        double deliverSeconds = 0;
+        double persistSeconds = 0;
+        uint64_t allocations = 0;
+        AMM::LatencyHistogram::Snapshot callback;
+    };
+
+    void ShowUsage(const string &name) {
+        cerr << "Usage: " << name << " <option(s)>"
+             << "\nOptions:\n"
+             << "\t-n <count>\t\tSamples delivered per sink and configuration (default 20000)\n"
+             << "\t-m <count>\t\tSimulated modules for the multi-module configurations (default 8)\n"
+             << "\t-d <dir>\t\tScratch directory for amm.db (default amm_bench)\n"
+             << "\t-h,--help\t\tShow this help message\n"
+             << endl;
+    }
+
+    /// Fake writer identity; the prefix is what the module registry keys on.
+    SampleInfo_t MakeInfo(int module) {
+        SampleInfo_t info;
+        GUID_t guid;
+        for (unsigned i = 0; i < GuidPrefix_t::size; ++i) {
+            guid.guidPrefix.value[i] = static_cast<octet>(i == 0 ? 0x01 : (module >> (8 * (i % 4))) & 0xff);
+        }
+        guid.guidPrefix.value[GuidPrefix_t::size - 1] = static_cast<octet>(module);
+        info.sample_identity.writer_guid(guid);
+        return info;
+    }
+
+    void Stamp(SampleInfo_t &info) {
+        const int64_t now = AMM::Clock::WallNs();
+        info.sourceTimestamp.seconds = static_cast<int32_t>(now / 1000000000);
+        info.sourceTimestamp.nanosec = static_cast<uint32_t>(now % 1000000000);
+    }
+
+    AMM::EventRecord MakeSample(uint64_t i, AMM::EventRecord *) {
+        AMM::EventRecord record;
+        AMM::UUID id;
+        id.id("00000000-0000-0000-0000-" + to_string(100000000000ULL + i));
+        record.id(id);
+        record.timestamp(i);
+        record.type("PATIENT_ACTION");
+        AMM::FMA_Location location;
+        location.name("right_forearm");
+        location.FMAID("9740");
+        record.location(location);
+        record.data("<data tourniquet=\"applied\"/>");
+        return record;
+    }
+
+    AMM::RenderModification MakeSample(uint64_t i, AMM::RenderModification *) {
+        AMM::RenderModification render;
+        AMM::UUID id;
+        id.id("00000000-0000-0000-0000-" + to_string(100000000000ULL + i));
+        render.event_id(id);
+        render.type("BLEEDING");
+        render.data(string("<RenderModification type=\"BLEEDING\" rate=\"") + to_string(i % 100) + "\"/>");
+        return render;
+    }
+
+    AMM::Log MakeSample(uint64_t i, AMM::Log *) {
+        AMM::Log log;
+        log.timestamp(i);
+        log.level(AMM::LogLevel::L_INFO);
+        log.message("Benchmark log line " + to_string(i));
+        return log;
+    }
+
+    AMM::Status MakeSample(uint64_t i, AMM::Status *) {
+        AMM::Status status;
+        status.module_name("Benchmark Module");
+        status.capability("heartbeat");
+        status.timestamp(i);
+        status.value(AMM::StatusValue::OPERATIONAL);
+        status.message("cycle " + to_string(i));
+        return status;
+    }
+
+    bool ResetDatabase() {
+        remove("amm.db");
+        remove("amm.db-wal");
+        remove("amm.db-shm");
+        sqlite3 *db = nullptr;
+        bool ok = sqlite3_open("amm.db", &db) == SQLITE_OK && AMM::CreateTables(db);
+        sqlite3_close(db);
+        return ok;
+    }
+
+    /// Event rows are committed asynchronously; table rows are written before the callback returns.
+    void WaitForCommits(const AMM::LatencyHistogram &committed, uint64_t expected, int64_t deadline) {
+        while (committed.Take().total < expected && AMM::Clock::NowNs() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    template<typename Sample>
+    Result Run(AMM::TopicId topic, const Configuration &config, uint64_t events) {
+        Result result;
+        if (!ResetDatabase()) {
+            cerr << "Unable to create amm.db" << endl;
+            return result;
+        }
+        AMM::Tracer::Enable(config.tracing);
+
+        vector<Sample> samples;
+        samples.reserve(events);
+        for (uint64_t i = 0; i < events; ++i) {
+            samples.push_back(MakeSample(i, static_cast<Sample *>(nullptr)));
+        }
+        vector<SampleInfo_t> infos;
+        for (int m = 0; m < config.modules; ++m) {
+            infos.push_back(MakeInfo(m + 1));
+        }
+
+        AMM::ModuleManager manager;
+        AMM::LatencyHistogram callback;
+        const AMM::LatencyHistogram &committed = manager.Latency().Get(topic, AMM::LatencyStage::DequeueToCommit);
+
+        // First sight of each module registers it and sizes thread-local buffers; keep that out of the numbers.
+        for (SampleInfo_t &info : infos) {
+            Stamp(info);
+            manager.Bus().Deliver(samples[0], info);
+        }
+        const uint64_t warmup = infos.size();
+        WaitForCommits(committed, warmup, AMM::Clock::NowNs() + 5LL * 1000000000);
+
+        const uint64_t allocationsBefore = AllocationCount();
+        const int64_t start = AMM::Clock::NowNs();
+        for (uint64_t i = 0; i < events; ++i) {
+            SampleInfo_t &info = infos[i % infos.size()];
+            Stamp(info);
+            const int64_t begin = AMM::Clock::NowNs();
+            manager.Bus().Deliver(samples[i], info);
+            callback.Record(AMM::Clock::NowNs() - begin);
+        }
+        const int64_t delivered = AMM::Clock::NowNs();
+        result.allocations = AllocationCount() - allocationsBefore;
+
+        WaitForCommits(committed, warmup + events, delivered + 30LL * 1000000000);
+
+        result.delivered = events;
+        result.persisted = committed.Take().total - warmup;
+        result.deliverSeconds = static_cast<double>(delivered - start) / 1e9;
+        result.persistSeconds = static_cast<double>(AMM::Clock::NowNs() - start) / 1e9;
+        result.callback = callback.Take();
+        AMM::Tracer::Enable(false);
+        return result;
+    }
+
+    void Print(const char *sink, const Configuration &config, const Result &result) {
+        cout << left << setw(20) << sink << setw(18) << config.name << right
+             << setw(10) << result.delivered
+             << setw(14) << static_cast<uint64_t>(result.delivered / result.deliverSeconds)
+             << setw(14) << static_cast<uint64_t>(result.persisted / result.persistSeconds)
+             << setw(10) << fixed << setprecision(2) << result.callback.Percentile(50) / 1e3
+             << setw(10) << result.callback.Percentile(99) / 1e3
+             << setw(12) << static_cast<double>(result.allocations) / result.delivered
+             << setw(10) << result.persisted << endl;
+    }
+}
+
+/// Drives the Module Manager's listeners with synthetic samples through a mock bus,
+/// so ingest throughput can be measured without a DDS domain.
+int main(int argc, char *argv[]) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+
+        if ((arg == "-h") || (arg == "--help")) {
+            ShowUsage(argv[0]);
+            return 0;
+        }
+
+        if (arg == "-n" && i + 1 < argc) {
+            options.events = strtoull(argv[++i], nullptr, 10);
+        }
+
+        if (arg == "-m" && i + 1 < argc) {
+            options.modules = atoi(argv[++i]);
+        }
+
+        if (arg == "-d" && i + 1 < argc) {
+            options.directory = argv[++i];
+        }
+    }
+    if (options.events == 0 || options.modules < 1) {
+        ShowUsage(argv[0]);
+        return 1;
+    }
+
+    static plog::ColorConsoleAppender <plog::TxtFormatter> consoleAppender;
+    plog::init(plog::warning, &consoleAppender);
+
+    mkdir(options.directory.c_str(), 0755);
+    if (chdir(options.directory.c_str()) != 0) {
+        cerr << "Unable to use " << options.directory << " as the scratch directory" << endl;
+        return 1;
+    }
+
+    const Configuration configurations[] = {
+            {"1 module", 1, false},
+            {"many modules", options.modules, false},
+            {"many, traced", options.modules, true},
+    };
+
+    cout << left << setw(20) << "sink" << setw(18) << "config" << right
+         << setw(10) << "events" << setw(14) << "delivered/s" << setw(14) << "persisted/s"
+         << setw(10) << "p50 us" << setw(10) << "p99 us" << setw(12) << "allocs/evt" << setw(10) << "persisted"
+         << endl;
+    for (const Configuration &config : configurations) {
+        Print("events:EventRecord", config,
+              Run<AMM::EventRecord>(AMM::TopicId::EventRecord, config, options.events));
+        Print("events:Render", config,
+              Run<AMM::RenderModification>(AMM::TopicId::RenderModification, config, options.events));
+        Print("logs:Log", config, Run<AMM::Log>(AMM::TopicId::Log, config, options.events));
+        Print("module_status", config, Run<AMM::Status>(AMM::TopicId::Status, config, options.events));
+    }
+    return 0;
+}
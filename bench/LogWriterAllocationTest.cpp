@@ -0,0 +1,93 @@
+#include "AllocationCounter.h"
+#include "LogWriter.h"
+#include "Schema.h"
+
+#include <sqlite3.h>
+
+#include <cstdio>
+#include <iostream>
+
+using namespace std;
+
+namespace {
+    const char *DatabaseFile = "amm_allocation_test.db";
+
+    const std::size_t BatchCapacity = 256;
+
+    bool ResetDatabase() {
+        remove(DatabaseFile);
+        sqlite3 *db = nullptr;
+        bool ok = sqlite3_open(DatabaseFile, &db) == SQLITE_OK && AMM::CreateTables(db);
+        sqlite3_close(db);
+        return ok;
+    }
+
+    void WriteEntries(AMM::LogWriter &writer, std::size_t count) {
+        for (std::size_t i = 0; i < count; ++i) {
+            AMM::LogEntry entry{"01.0f.44.55.66.77.88.99.aa.bb.cc.dd", static_cast<uint32_t>(i % 8 + 1),
+                                AMM::TopicId::EventRecord, "00000000-0000-0000-0000-100000000000", i,
+                                "<data tourniquet=\"applied\" location=\"right_forearm\" fmaid=\"9740\"/>",
+                                {AMM::Clock::WallNs(), AMM::Clock::NowNs()}};
+            writer.Write(std::move(entry));
+        }
+    }
+
+    /// Commits happen on the writer thread; waits until `expected` rows have been stored or lost.
+    bool WaitForRows(const AMM::LogWriter &writer, uint64_t expected) {
+        const int64_t deadline = AMM::Clock::NowNs() + 10LL * 1000000000;
+        while (writer.Committed() + writer.Failed() + writer.Dropped() < expected) {
+            if (AMM::Clock::NowNs() > deadline) {
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return true;
+    }
+}
+
+/// Checks that LogWriter::Write and the commits behind it stop allocating once both
+/// batches have been used: every operator new between warm-up and the last commit fails the test.
+int main() {
+    if (!ResetDatabase()) {
+        cerr << "Unable to create " << DatabaseFile << endl;
+        return 1;
+    }
+
+    std::mutex dbMutex;
+    AMM::LatencyStats latency;
+    AMM::MetricsRegistry metrics;
+    AMM::LogWriter writer(DatabaseFile, dbMutex, &latency, &metrics, BatchCapacity);
+    writer.Start();
+
+    // Opening the database, naming the writer thread and growing both batch arenas allocate once.
+    uint64_t expected = 0;
+    for (int round = 0; round < 4; ++round) {
+        WriteEntries(writer, BatchCapacity);
+        expected += BatchCapacity;
+        if (!WaitForRows(writer, expected)) {
+            cerr << "Warm-up rows were not committed" << endl;
+            return 1;
+        }
+    }
+
+    const uint64_t before = AllocationCount();
+    for (int round = 0; round < 40; ++round) {
+        WriteEntries(writer, BatchCapacity / 2);
+        expected += BatchCapacity / 2;
+    }
+    const bool committed = WaitForRows(writer, expected);
+    const uint64_t allocations = AllocationCount() - before;
+    writer.Stop();
+
+    cout << "rows committed " << writer.Committed() << ", failed " << writer.Failed() << ", dropped "
+         << writer.Dropped() << ", allocations in steady state " << allocations << endl;
+    if (!committed || writer.Committed() != expected) {
+        cerr << "Not every row was committed" << endl;
+        return 1;
+    }
+    if (allocations != 0) {
+        cerr << "LogWriter allocated " << allocations << " times after warm-up" << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "amm_std.h"
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <tuple>
+
+namespace AMM {
+
+/// In-process stand-in for DDSManager with the interface the Module Manager uses.
+/// Subscriptions are remembered so Deliver() can call a listener directly, the way
+/// a DDS listener thread would; writes are only counted.
+    template<typename Listener>
+    class MockDDSManager {
+
+    public:
+        explicit MockDDSManager(const std::string &) {}
+
+        void Shutdown() {}
+
+        std::string GenerateUuidString() {
+            return "00000000-0000-0000-0000-" + std::to_string(100000000000ULL + m_uuids++);
+        }
+
+        /// Calls the listener subscribed to the sample's topic, if any.
+        template<typename Sample>
+        void Deliver(Sample &sample, SampleInfo_t &info) {
+            Subscription<Sample> &subscription = std::get<Subscription<Sample>>(m_subscriptions);
+            if (subscription.listener != nullptr) {
+                (subscription.listener->*subscription.callback)(sample, &info);
+            }
+        }
+
+        uint64_t Published() const { return m_published.load(std::memory_order_relaxed); }
+
+#define AMM_MOCK_TOPIC(Topic)                                                                        \
+        void Initialize##Topic() {}                                                                  \
+                                                                                                     \
+        void Create##Topic##Subscriber(Listener *listener, void (Listener::*callback)(AMM::Topic &,  \
+                                                                                     SampleInfo_t *)) { \
+            std::get<Subscription<AMM::Topic>>(m_subscriptions) = {listener, callback};              \
+        }                                                                                            \
+                                                                                                     \
+        void Create##Topic##Publisher() {}                                                           \
+                                                                                                     \
+        bool Write##Topic(AMM::Topic &) {                                                            \
+            m_published.fetch_add(1, std::memory_order_relaxed);                                     \
+            return true;                                                                             \
+        }
+
+        AMM_MOCK_TOPIC(SimulationControl)
+        AMM_MOCK_TOPIC(Assessment)
+        AMM_MOCK_TOPIC(Log)
+        AMM_MOCK_TOPIC(RenderModification)
+        AMM_MOCK_TOPIC(PhysiologyModification)
+        AMM_MOCK_TOPIC(EventRecord)
+        AMM_MOCK_TOPIC(EventFragment)
+        AMM_MOCK_TOPIC(Command)
+        AMM_MOCK_TOPIC(FragmentAmendmentRequest)
+        AMM_MOCK_TOPIC(OmittedEvent)
+        AMM_MOCK_TOPIC(OperationalDescription)
+        AMM_MOCK_TOPIC(ModuleConfiguration)
+        AMM_MOCK_TOPIC(Status)
+
+#undef AMM_MOCK_TOPIC
+
+    private:
+        template<typename Sample>
+        struct Subscription {
+            Listener *listener;
+            void (Listener::*callback)(Sample &, SampleInfo_t *);
+        };
+
+        std::tuple<Subscription<AMM::SimulationControl>, Subscription<AMM::Assessment>, Subscription<AMM::Log>,
+                Subscription<AMM::RenderModification>, Subscription<AMM::PhysiologyModification>,
+                Subscription<AMM::EventRecord>, Subscription<AMM::EventFragment>, Subscription<AMM::Command>,
+                Subscription<AMM::FragmentAmendmentRequest>, Subscription<AMM::OmittedEvent>,
+                Subscription<AMM::OperationalDescription>, Subscription<AMM::ModuleConfiguration>,
+                Subscription<AMM::Status>> m_subscriptions{};
+
+        std::atomic<uint64_t> m_uuids{0};
+        std::atomic<uint64_t> m_published{0};
+    };
+
+} // namespace AMM
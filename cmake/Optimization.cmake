@@ -0,0 +1,60 @@
+#############################
+# Release, LTO and PGO settings
+#############################
+
+# Single-configuration generators get an optimized build unless told otherwise.
+if (NOT CMAKE_BUILD_TYPE AND NOT CMAKE_CONFIGURATION_TYPES)
+    set(CMAKE_BUILD_TYPE Release CACHE STRING "Choose the type of build" FORCE)
+    set_property(CACHE CMAKE_BUILD_TYPE PROPERTY STRINGS Debug Release RelWithDebInfo MinSizeRel)
+endif ()
+
+option(AMM_ENABLE_LTO "Link-time optimization for Release and RelWithDebInfo builds" ON)
+
+set(AMM_PGO "OFF" CACHE STRING "Profile-guided optimization: OFF, GENERATE or USE")
+set_property(CACHE AMM_PGO PROPERTY STRINGS OFF GENERATE USE)
+set(AMM_PGO_DATA "${CMAKE_BINARY_DIR}/pgo-data" CACHE PATH "Directory training runs write profiles to")
+
+if (AMM_ENABLE_LTO)
+    include(CheckIPOSupported)
+    check_ipo_supported(RESULT AMM_LTO_SUPPORTED OUTPUT AMM_LTO_ERROR LANGUAGES CXX)
+    if (AMM_LTO_SUPPORTED)
+        set(CMAKE_INTERPROCEDURAL_OPTIMIZATION_RELEASE ON)
+        set(CMAKE_INTERPROCEDURAL_OPTIMIZATION_RELWITHDEBINFO ON)
+    else ()
+        message(WARNING "Link-time optimization is not supported here: ${AMM_LTO_ERROR}")
+    endif ()
+endif ()
+
+string(TOUPPER "${AMM_PGO}" AMM_PGO_MODE)
+if (AMM_PGO_MODE STREQUAL "GENERATE")
+    if (CMAKE_CXX_COMPILER_ID STREQUAL "GNU")
+        # The manager and its writer threads update counters concurrently.
+        add_compile_options(-fprofile-generate=${AMM_PGO_DATA} -fprofile-update=atomic)
+        add_link_options(-fprofile-generate=${AMM_PGO_DATA})
+    elseif (CMAKE_CXX_COMPILER_ID MATCHES "Clang")
+        add_compile_options(-fprofile-generate=${AMM_PGO_DATA})
+        add_link_options(-fprofile-generate=${AMM_PGO_DATA})
+    else ()
+        message(FATAL_ERROR "AMM_PGO needs GCC or Clang, not ${CMAKE_CXX_COMPILER_ID}")
+    endif ()
+elseif (AMM_PGO_MODE STREQUAL "USE")
+    if (CMAKE_CXX_COMPILER_ID STREQUAL "GNU")
+        # GCC names each profile after its object's path, so USE must reconfigure the GENERATE build tree.
+        file(GLOB AMM_PGO_PROFILES "${AMM_PGO_DATA}/*.gcda")
+        if (NOT AMM_PGO_PROFILES)
+            message(FATAL_ERROR "No profiles in ${AMM_PGO_DATA}; build with AMM_PGO=GENERATE and train first")
+        endif ()
+        add_compile_options(-fprofile-use=${AMM_PGO_DATA} -fprofile-correction -Wno-missing-profile)
+        add_link_options(-fprofile-use=${AMM_PGO_DATA})
+    elseif (CMAKE_CXX_COMPILER_ID MATCHES "Clang")
+        if (NOT EXISTS "${AMM_PGO_DATA}/default.profdata")
+            message(FATAL_ERROR "No ${AMM_PGO_DATA}/default.profdata; merge the .profraw files with llvm-profdata")
+        endif ()
+        add_compile_options(-fprofile-use=${AMM_PGO_DATA}/default.profdata -Wno-profile-instr-unprofiled)
+        add_link_options(-fprofile-use=${AMM_PGO_DATA}/default.profdata)
+    else ()
+        message(FATAL_ERROR "AMM_PGO needs GCC or Clang, not ${CMAKE_CXX_COMPILER_ID}")
+    endif ()
+elseif (NOT AMM_PGO_MODE STREQUAL "OFF")
+    message(FATAL_ERROR "AMM_PGO must be OFF, GENERATE or USE, not ${AMM_PGO}")
+endif ()
@@ -0,0 +1,220 @@
+#include "AdminServer.h"
+
+#include "plog/Log.h"
+
+#include <sstream>
+
+#ifdef __linux__
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace AMM {
+    namespace {
+        /// A request line longer than this is a confused client, not a command.
+        const std::size_t MaxRequest = 4096;
+
+#ifdef __linux__
+        /// Binds under a umask that leaves the socket readable and writable by this user only, so
+        /// there is no moment at which another user could connect. The umask is process-wide, which
+        /// is why the manager opens the socket before it starts any other thread.
+        int BindPrivate(int fd, const sockaddr_un &address) {
+            const mode_t previous = umask(S_IXUSR | S_IRWXG | S_IRWXO);
+            const int bound = bind(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address));
+            const int error = errno;
+            umask(previous);
+            errno = error;
+            return bound;
+        }
+#endif
+    }
+
+    AdminServer::AdminServer(EventLoop &loop) : m_loop(loop) {
+        AddCommand("help", "List commands", [this](const std::string &, std::ostream &out) {
+            for (const auto &command : m_commands) {
+                out << command.first << "\t" << command.second.help << "\n";
+            }
+            return true;
+        });
+    }
+
+    AdminServer::~AdminServer() {
+        Close();
+    }
+
+    void AdminServer::AddCommand(const std::string &name, const std::string &help, Handler handler) {
+        m_commands[name] = Command{help, std::move(handler)};
+    }
+
+    bool AdminServer::Open(const std::string &path) {
+#ifdef __linux__
+        sockaddr_un address = {};
+        address.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(address.sun_path)) {
+            LOG_ERROR << "Admin socket path is too long: " << path;
+            return false;
+        }
+        std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+        m_listener = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (m_listener < 0) {
+            LOG_ERROR << "Unable to create admin socket: " << std::strerror(errno);
+            return false;
+        }
+
+        int bound = BindPrivate(m_listener, address);
+        if (bound != 0 && errno == EADDRINUSE) {
+            // Only take the path over if nobody is answering on it.
+            int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            const bool live = connect(probe, reinterpret_cast<sockaddr *>(&address), sizeof(address)) == 0;
+            close(probe);
+            if (live) {
+                LOG_ERROR << "Another Module Manager is serving " << path;
+                Close();
+                return false;
+            }
+            unlink(path.c_str());
+            bound = BindPrivate(m_listener, address);
+        }
+        if (bound != 0) {
+            LOG_ERROR << "Unable to bind admin socket " << path << ": " << std::strerror(errno);
+            Close();
+            return false;
+        }
+        m_path = path;
+
+        if (listen(m_listener, 8) != 0 || !m_loop.Watch(m_listener, [this] { Accept(); })) {
+            LOG_ERROR << "Unable to listen on admin socket " << path << ": " << std::strerror(errno);
+            Close();
+            return false;
+        }
+        LOG_INFO << "Admin socket listening on " << path;
+        return true;
+#else
+        LOG_ERROR << "The admin socket is only supported on Linux.";
+        return false;
+#endif
+    }
+
+    void AdminServer::Close() {
+#ifdef __linux__
+        while (!m_clients.empty()) {
+            Drop(m_clients.begin()->first);
+        }
+        if (m_listener >= 0) {
+            m_loop.Unwatch(m_listener);
+            close(m_listener);
+            m_listener = -1;
+        }
+        if (!m_path.empty()) {
+            unlink(m_path.c_str());
+            m_path.clear();
+        }
+#endif
+    }
+
+    void AdminServer::Accept() {
+#ifdef __linux__
+        int fd;
+        while ((fd = accept4(m_listener, nullptr, nullptr, SOCK_CLOEXEC)) >= 0) {
+            // Replies are written whole; a client that stops reading is dropped after a second
+            // rather than holding up the loop.
+            timeval timeout = {1, 0};
+            setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+            m_clients[fd].reset(new Client);
+            if (!m_loop.Watch(fd, [this, fd] { Read(fd); })) {
+                Drop(fd);
+            }
+        }
+#endif
+    }
+
+    void AdminServer::Read(int fd) {
+#ifdef __linux__
+        auto it = m_clients.find(fd);
+        if (it == m_clients.end()) {
+            return;
+        }
+        Client &client = *it->second;
+
+        char buffer[512];
+        const ssize_t count = recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+        if (count <= 0) {
+            if (count == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+                Drop(fd);
+            }
+            return;
+        }
+        client.pending.append(buffer, static_cast<std::size_t>(count));
+
+        std::size_t end;
+        while ((end = client.pending.find('\n')) != std::string::npos) {
+            std::string request = client.pending.substr(0, end);
+            client.pending.erase(0, end + 1);
+            if (!request.empty() && request.back() == '\r') {
+                request.pop_back();
+            }
+
+            const std::string reply = Execute(request);
+            std::size_t sent = 0;
+            while (sent < reply.size()) {
+                const ssize_t written = send(fd, reply.data() + sent, reply.size() - sent, MSG_NOSIGNAL);
+                if (written <= 0) {
+                    Drop(fd);
+                    return;
+                }
+                sent += static_cast<std::size_t>(written);
+            }
+            if (m_clients.find(fd) == m_clients.end()) {
+                // The command closed the server, e.g. shutdown.
+                return;
+            }
+        }
+        if (client.pending.size() > MaxRequest) {
+            Drop(fd);
+        }
+#endif
+    }
+
+    void AdminServer::Drop(int fd) {
+#ifdef __linux__
+        m_loop.Unwatch(fd);
+        close(fd);
+        m_clients.erase(fd);
+#endif
+    }
+
+    std::string AdminServer::Execute(const std::string &request) {
+        const std::size_t split = request.find(' ');
+        const std::string name = request.substr(0, split);
+        const std::string arguments = split == std::string::npos ? std::string() : request.substr(split + 1);
+
+        auto it = m_commands.find(name);
+        if (it == m_commands.end()) {
+            return "ERR unknown command '" + name + "'\n";
+        }
+
+        std::ostringstream out;
+        bool ok = false;
+        try {
+            ok = it->second.handler(arguments, out);
+        } catch (std::exception &e) {
+            out.str(e.what());
+        }
+        std::string body = out.str();
+        if (!ok) {
+            for (char &c : body) {
+                if (c == '\n') {
+                    c = ' ';
+                }
+            }
+            return "ERR " + body + "\n";
+        }
+        return "OK " + std::to_string(body.size()) + "\n" + body;
+    }
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "EventLoop.h"
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <string>
+
+namespace AMM {
+
+/// Local control socket for scripts. Each request is one line, "<command> [arguments]";
+/// each reply is "OK <length>\n" followed by <length> bytes of output, or "ERR <reason>\n".
+/// Connections are served on the event loop thread, never on a DDS listener.
+    class AdminServer {
+
+    public:
+        /// Writes the command's output; returns false to reply ERR with that output as the reason.
+        typedef std::function<bool(const std::string &arguments, std::ostream &out)> Handler;
+
+        explicit AdminServer(EventLoop &loop);
+
+        ~AdminServer();
+
+        AdminServer(const AdminServer &) = delete;
+
+        AdminServer &operator=(const AdminServer &) = delete;
+
+        void AddCommand(const std::string &name, const std::string &help, Handler handler);
+
+        /// Listens on a Unix socket at `path`, readable by this user only. A stale socket left
+        /// by a dead manager is replaced; one another manager is serving is not.
+        bool Open(const std::string &path);
+
+        void Close();
+
+    private:
+        struct Command {
+            std::string help;
+            Handler handler;
+        };
+
+        struct Client {
+            std::string pending;
+        };
+
+        void Accept();
+
+        void Read(int fd);
+
+        void Drop(int fd);
+
+        std::string Execute(const std::string &request);
+
+        EventLoop &m_loop;
+        std::map<std::string, Command> m_commands;
+        std::map<int, std::unique_ptr<Client>> m_clients;
+        std::string m_path;
+        int m_listener = -1;
+    };
+
+} // namespace AMM
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "amm_std.h"
+
+#ifdef AMM_MOCK_BUS
+#include "MockDDSManager.h"
+#endif
+
+namespace AMM {
+
+/// DDS manager the Module Manager is wired to. The benchmarks build the manager
+/// with AMM_MOCK_BUS defined, which swaps in an in-process stand-in that needs
+/// no domain and lets them deliver samples straight to the listeners.
+#ifdef AMM_MOCK_BUS
+    template<typename Listener> using BusManager = MockDDSManager<Listener>;
+#else
+    template<typename Listener> using BusManager = DDSManager<Listener>;
+#endif
+
+} // namespace AMM
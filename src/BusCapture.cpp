@@ -0,0 +1,198 @@
+#include "BusCapture.h"
+
+#include "ThreadPlacement.h"
+#include "Tracer.h"
+
+#include "plog/Log.h"
+
+#include <chrono>
+#include <cstring>
+
+namespace AMM {
+    namespace {
+        const std::chrono::milliseconds FlushInterval(100);
+
+        /// size, topic, 3 reserved bytes, source, receive, writer prefix.
+        const std::size_t RecordHeaderSize = 4 + 1 + 3 + 8 + 8 + 12;
+
+        template<typename T>
+        char *Put(char *at, const T &value) {
+            std::memcpy(at, &value, sizeof(value));
+            return at + sizeof(value);
+        }
+
+        template<typename T>
+        const char *Get(const char *at, T &value) {
+            std::memcpy(&value, at, sizeof(value));
+            return at + sizeof(value);
+        }
+    }
+
+    CaptureWriter::CaptureWriter(MetricsRegistry *metrics) {
+        if (metrics != nullptr) {
+            m_recordCount = &metrics->AddCounter("amm_capture_records_total", "Samples written to the bus capture.");
+            m_droppedCount = &metrics->AddCounter("amm_capture_dropped_total",
+                                                  "Samples left out of the bus capture because the disk fell "
+                                                  "behind or failed.");
+        }
+    }
+
+    CaptureWriter::~CaptureWriter() {
+        Stop();
+    }
+
+    bool CaptureWriter::Start(const std::string &fileName) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_running) {
+            return false;
+        }
+        m_file.open(fileName, std::ios::binary | std::ios::trunc);
+        if (!m_file) {
+            LOG_ERROR << "Unable to open capture file " << fileName;
+            return false;
+        }
+        m_file.write(CaptureMagic, sizeof(CaptureMagic));
+        m_fileName = fileName;
+        m_pendingRecords = 0;
+        m_records = 0;
+        m_dropped = 0;
+        m_running = true;
+        m_thread = std::thread(&CaptureWriter::Run, this);
+        m_active.store(true, std::memory_order_relaxed);
+        LOG_INFO << "Recording bus traffic to " << fileName;
+        return true;
+    }
+
+    void CaptureWriter::Stop() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_running) {
+                return;
+            }
+            m_active.store(false, std::memory_order_relaxed);
+            m_running = false;
+        }
+        m_cv.notify_one();
+        if (m_thread.joinable()) {
+            m_thread.join();
+        }
+        m_file.close();
+        LOG_INFO << "Capture " << m_fileName << " closed: " << m_records << " samples, " << m_dropped << " dropped";
+    }
+
+    uint64_t CaptureWriter::Records() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_records;
+    }
+
+    void CaptureWriter::Append(TopicId topic, const SampleInfo_t *info, const SampleTimes &times,
+                               const std::vector<char> &payload) {
+        if (payload.size() > CaptureMaxSample) {
+            LOG_WARNING << "Leaving a " << payload.size() << " byte " << TopicName(topic)
+                        << " sample out of the capture; replay could not trust its size.";
+            return;
+        }
+        char header[RecordHeaderSize] = {};
+        char *at = Put(header, static_cast<uint32_t>(payload.size()));
+        at = Put(at, static_cast<uint8_t>(topic));
+        at += 3;
+        at = Put(at, times.source);
+        at = Put(at, times.receive);
+        if (info != nullptr) {
+            std::memcpy(at, info->sample_identity.writer_guid().guidPrefix.value, 12);
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_running) {
+            return;
+        }
+        if (m_pending.size() + sizeof(header) + payload.size() > MaxPending) {
+            ++m_dropped;
+            if (m_droppedCount != nullptr) {
+                m_droppedCount->Increment();
+            }
+            return;
+        }
+        m_pending.insert(m_pending.end(), header, header + sizeof(header));
+        m_pending.insert(m_pending.end(), payload.begin(), payload.end());
+        ++m_pendingRecords;
+    }
+
+    void CaptureWriter::Run() {
+        ThreadPlacement::Apply(ThreadRole::Writer, "capture-writer");
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true) {
+            m_cv.wait_for(lock, FlushInterval, [this] { return !m_running; });
+            bool finished = !m_running;
+            std::swap(m_pending, m_writing);
+            const uint64_t records = m_pendingRecords;
+            m_pendingRecords = 0;
+            lock.unlock();
+
+            // Once a write has failed the file is truncated; everything after it counts as dropped.
+            if (!m_writing.empty() && m_file) {
+                TraceSpan span("WriteCapture", "capture");
+                m_file.write(m_writing.data(), static_cast<std::streamsize>(m_writing.size()));
+                m_file.flush();
+                if (!m_file) {
+                    LOG_ERROR << "Unable to write capture file " << m_fileName << ", recording stopped.";
+                    m_active.store(false, std::memory_order_relaxed);
+                }
+            }
+            const bool written = static_cast<bool>(m_file);
+            m_writing.clear();
+
+            lock.lock();
+            if (written) {
+                m_records += records;
+                if (m_recordCount != nullptr) {
+                    m_recordCount->Increment(records);
+                }
+            } else {
+                m_dropped += records;
+                if (m_droppedCount != nullptr) {
+                    m_droppedCount->Increment(records);
+                }
+            }
+            if (finished && m_pending.empty()) {
+                break;
+            }
+        }
+    }
+
+    bool CaptureReader::Open(const std::string &fileName) {
+        m_file.open(fileName, std::ios::binary);
+        char magic[sizeof(CaptureMagic)] = {};
+        if (!m_file.read(magic, sizeof(magic)) || std::memcmp(magic, CaptureMagic, sizeof(magic)) != 0) {
+            LOG_ERROR << fileName << " is not an AMM capture file";
+            return false;
+        }
+        return true;
+    }
+
+    bool CaptureReader::Next(CaptureRecord &record) {
+        char header[RecordHeaderSize];
+        if (!m_file.read(header, sizeof(header))) {
+            return false;
+        }
+        uint32_t size = 0;
+        uint8_t topic = 0;
+        const char *at = Get(header, size);
+        at = Get(at, topic);
+        at += 3;
+        at = Get(at, record.source);
+        at = Get(at, record.receive);
+        std::memcpy(record.writer, at, sizeof(record.writer));
+        if (topic >= TopicCount) {
+            LOG_ERROR << "Capture record has unknown topic " << static_cast<int>(topic);
+            return false;
+        }
+        if (size > CaptureMaxSample) {
+            LOG_ERROR << "Capture record claims a " << size << " byte sample, more than a capture holds";
+            return false;
+        }
+        record.topic = static_cast<TopicId>(topic);
+        record.payload.resize(size);
+        return size == 0 || static_cast<bool>(m_file.read(record.payload.data(), size));
+    }
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include "Clock.h"
+#include "Metrics.h"
+#include "Topics.h"
+
+#include <fastcdr/Cdr.h>
+#include <fastcdr/FastBuffer.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace AMM {
+
+/// Capture files start with this magic, followed by records back to back. Each record
+/// is a fixed header (in the recording host's byte order) and the sample in DDS CDR form,
+/// exactly as a reader would deserialize it.
+    const char CaptureMagic[8] = {'A', 'M', 'M', 'C', 'A', 'P', '0', '1'};
+
+/// Largest serialized sample a capture holds. Larger samples are not recorded, and a record
+/// claiming more is treated as corrupt rather than trusted with an allocation.
+    const std::size_t CaptureMaxSample = 16 * 1024 * 1024;
+
+    struct CaptureRecord {
+        TopicId topic;
+        /// Writer's source timestamp in ns, 0 if the sample had none.
+        int64_t source;
+        /// Receive time in the manager, ns; replay is paced on this.
+        int64_t receive;
+        /// GUID prefix of the writer's participant.
+        uint8_t writer[12];
+        std::vector<char> payload;
+    };
+
+/// Serializes a sample with its encapsulation header into `out`, reusing its capacity.
+    template<typename Sample>
+    bool SerializeSample(const Sample &sample, std::vector<char> &out) {
+        out.resize(Sample::getCdrSerializedSize(sample) + 4);
+        eprosima::fastcdr::FastBuffer buffer(out.data(), out.size());
+        eprosima::fastcdr::Cdr cdr(buffer, eprosima::fastcdr::Cdr::DEFAULT_ENDIAN, eprosima::fastcdr::Cdr::DDS_CDR);
+        try {
+            cdr.serialize_encapsulation();
+            sample.serialize(cdr);
+        } catch (std::exception &) {
+            return false;
+        }
+        out.resize(cdr.getSerializedDataLength());
+        return true;
+    }
+
+    template<typename Sample>
+    bool DeserializeSample(std::vector<char> &payload, Sample &sample) {
+        eprosima::fastcdr::FastBuffer buffer(payload.data(), payload.size());
+        eprosima::fastcdr::Cdr cdr(buffer, eprosima::fastcdr::Cdr::DEFAULT_ENDIAN, eprosima::fastcdr::Cdr::DDS_CDR);
+        try {
+            cdr.read_encapsulation();
+            sample.deserialize(cdr);
+        } catch (std::exception &) {
+            return false;
+        }
+        return true;
+    }
+
+/// Appends received samples to a capture file from its own thread. Listeners only
+/// serialize into a thread-local buffer and copy it into the pending block.
+    class CaptureWriter {
+
+    public:
+        /// Pending bytes beyond which records are dropped rather than buffered.
+        static const std::size_t MaxPending = 64 * 1024 * 1024;
+
+        explicit CaptureWriter(MetricsRegistry *metrics = nullptr);
+
+        ~CaptureWriter();
+
+        CaptureWriter(const CaptureWriter &) = delete;
+
+        CaptureWriter &operator=(const CaptureWriter &) = delete;
+
+        bool Start(const std::string &fileName);
+
+        /// Writes whatever is pending and closes the file.
+        void Stop();
+
+        bool Active() const { return m_active.load(std::memory_order_relaxed); }
+
+        template<typename Sample>
+        void Record(TopicId topic, const Sample &sample, const SampleInfo_t *info, const SampleTimes &times) {
+            thread_local std::vector<char> payload;
+            if (SerializeSample(sample, payload)) {
+                Append(topic, info, times, payload);
+            }
+        }
+
+        /// Samples written to the file so far; those still pending are not counted yet.
+        uint64_t Records() const;
+
+    private:
+        void Append(TopicId topic, const SampleInfo_t *info, const SampleTimes &times,
+                    const std::vector<char> &payload);
+
+        void Run();
+
+        std::atomic<bool> m_active{false};
+        mutable std::mutex m_mutex;
+        std::condition_variable m_cv;
+        std::thread m_thread;
+        bool m_running = false;
+        std::ofstream m_file;
+        std::string m_fileName;
+        std::vector<char> m_pending;
+        std::vector<char> m_writing;
+        uint64_t m_pendingRecords = 0;
+        uint64_t m_records = 0;
+        uint64_t m_dropped = 0;
+
+        Counter *m_recordCount = nullptr;
+        Counter *m_droppedCount = nullptr;
+    };
+
+/// Reads a capture file record by record.
+    class CaptureReader {
+
+    public:
+        bool Open(const std::string &fileName);
+
+        /// False at the end of the file, or on a truncated or corrupt record.
+        bool Next(CaptureRecord &record);
+
+    private:
+        std::ifstream m_file;
+    };
+
+} // namespace AMM
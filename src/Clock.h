@@ -0,0 +1,51 @@
+#pragma once
+
+#include "amm_std.h"
+
+#include <chrono>
+#include <cstdint>
+
+namespace AMM {
+
+/// Timestamps used to order and measure stored samples, all in nanoseconds
+/// since the Unix epoch.
+    namespace Clock {
+
+        inline int64_t WallNs() {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::system_clock::now().time_since_epoch()).count();
+        }
+
+        /// Monotonic time, anchored to the wall clock once per process. Readings never
+        /// go backwards and stay comparable with DDS source timestamps.
+        inline int64_t NowNs() {
+            static const int64_t steadyAnchor = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count();
+            static const int64_t wallAnchor = WallNs();
+            return wallAnchor - steadyAnchor + std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        /// Time the writer stamped on a sample, or 0 if the sample carries none.
+        inline int64_t SourceNs(const SampleInfo_t *info) {
+            if (info == nullptr || info->sourceTimestamp.seconds < 0) {
+                return 0;
+            }
+            return info->sourceTimestamp.to_ns();
+        }
+
+        inline uint64_t ToMs(int64_t ns) {
+            return ns > 0 ? static_cast<uint64_t>(ns / 1000000) : 0;
+        }
+    }
+
+/// Timing captured for every stored sample. Commit time is added by whoever persists it.
+    struct SampleTimes {
+        /// Writer's source timestamp from SampleInfo_t.
+        int64_t source;
+
+        /// Monotonic receive time in the listener.
+        int64_t receive;
+    };
+
+} // namespace AMM
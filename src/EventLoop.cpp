@@ -0,0 +1,302 @@
+#include "EventLoop.h"
+
+#include "plog/Log.h"
+
+#include <algorithm>
+#include <atomic>
+#include <csignal>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#endif
+
+namespace AMM {
+    namespace {
+        const int HandledSignals[] = {SIGINT, SIGTERM, SIGHUP};
+
+#ifndef __linux__
+        std::atomic<int> s_pendingSignal(0);
+
+        void RecordSignal(int signal) {
+            s_pendingSignal.store(signal);
+        }
+#endif
+    }
+
+    EventLoop::EventLoop() : m_signalHandler([this](int) { Stop(); }) {
+    }
+
+    EventLoop::~EventLoop() {
+#ifdef __linux__
+        for (auto &timer : m_timers) {
+            close(timer.second.fd);
+        }
+        for (int fd : {m_signalFd, m_wakeFd, m_epoll}) {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+#endif
+    }
+
+    bool EventLoop::Open() {
+#ifdef __linux__
+        sigset_t signals;
+        sigemptyset(&signals);
+        for (int signal : HandledSignals) {
+            sigaddset(&signals, signal);
+        }
+        if (pthread_sigmask(SIG_BLOCK, &signals, nullptr) != 0) {
+            LOG_ERROR << "Unable to block shutdown signals";
+            return false;
+        }
+
+        m_epoll = epoll_create1(EPOLL_CLOEXEC);
+        m_signalFd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+        m_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (m_epoll < 0 || m_signalFd < 0 || m_wakeFd < 0) {
+            LOG_ERROR << "Unable to create event loop descriptors";
+            return false;
+        }
+        for (int fd : {m_signalFd, m_wakeFd}) {
+            epoll_event event = {};
+            event.events = EPOLLIN;
+            event.data.fd = fd;
+            epoll_ctl(m_epoll, EPOLL_CTL_ADD, fd, &event);
+        }
+#else
+        for (int signal : HandledSignals) {
+            std::signal(signal, &RecordSignal);
+        }
+#endif
+        return true;
+    }
+
+    void EventLoop::OnSignal(std::function<void(int)> handler) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_signalHandler = std::move(handler);
+    }
+
+    int EventLoop::AddTimer(std::chrono::milliseconds delay, std::chrono::milliseconds interval, Task task) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const int id = m_nextTimer++;
+        Timer &timer = m_timers[id];
+        timer.due = std::chrono::steady_clock::now() + delay;
+        timer.interval = interval;
+        timer.task = std::move(task);
+#ifdef __linux__
+        timer.fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        itimerspec spec = {};
+        // A zero it_value disarms the timer, so an immediate timer fires after 1 ns.
+        const int64_t delayNs = std::max<int64_t>(1, std::chrono::nanoseconds(delay).count());
+        spec.it_value.tv_sec = static_cast<time_t>(delayNs / 1000000000);
+        spec.it_value.tv_nsec = static_cast<long>(delayNs % 1000000000);
+        const int64_t intervalNs = std::chrono::nanoseconds(interval).count();
+        spec.it_interval.tv_sec = static_cast<time_t>(intervalNs / 1000000000);
+        spec.it_interval.tv_nsec = static_cast<long>(intervalNs % 1000000000);
+        timerfd_settime(timer.fd, 0, &spec, nullptr);
+
+        epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.fd = timer.fd;
+        epoll_ctl(m_epoll, EPOLL_CTL_ADD, timer.fd, &event);
+#else
+        m_cv.notify_one();
+#endif
+        return id;
+    }
+
+    void EventLoop::CancelTimer(int id) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_timers.find(id);
+        if (it == m_timers.end()) {
+            return;
+        }
+#ifdef __linux__
+        epoll_ctl(m_epoll, EPOLL_CTL_DEL, it->second.fd, nullptr);
+        close(it->second.fd);
+#endif
+        m_timers.erase(it);
+    }
+
+    bool EventLoop::Watch(int fd, Task task) {
+#ifdef __linux__
+        std::lock_guard<std::mutex> lock(m_mutex);
+        epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        if (epoll_ctl(m_epoll, EPOLL_CTL_ADD, fd, &event) != 0) {
+            return false;
+        }
+        m_watched[fd] = std::move(task);
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    void EventLoop::Unwatch(int fd) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+#ifdef __linux__
+        epoll_ctl(m_epoll, EPOLL_CTL_DEL, fd, nullptr);
+#endif
+        m_watched.erase(fd);
+    }
+
+    void EventLoop::Post(Task task) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_posted.push_back(std::move(task));
+        }
+        Wake();
+    }
+
+    void EventLoop::Stop() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopped = true;
+        }
+        Wake();
+    }
+
+    bool EventLoop::Stopped() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_stopped;
+    }
+
+    void EventLoop::Wake() {
+#ifdef __linux__
+        const uint64_t one = 1;
+        if (write(m_wakeFd, &one, sizeof(one)) < 0) {
+            // Counter saturated; the loop is already due to wake.
+        }
+#else
+        m_cv.notify_one();
+#endif
+    }
+
+    void EventLoop::RunPosted() {
+        std::vector<Task> posted;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            posted.swap(m_posted);
+        }
+        for (Task &task : posted) {
+            task();
+        }
+    }
+
+    void EventLoop::RunTimer(int id) {
+        Task task;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto it = m_timers.find(id);
+            if (it == m_timers.end()) {
+                return;
+            }
+            task = it->second.task;
+            it->second.due += it->second.interval;
+        }
+        if (task) {
+            task();
+        }
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_timers.find(id);
+        if (it != m_timers.end() && it->second.interval.count() == 0) {
+#ifdef __linux__
+            epoll_ctl(m_epoll, EPOLL_CTL_DEL, it->second.fd, nullptr);
+            close(it->second.fd);
+#endif
+            m_timers.erase(it);
+        }
+    }
+
+    void EventLoop::Run() {
+#ifdef __linux__
+        epoll_event events[16];
+        while (!Stopped()) {
+            const int ready = epoll_wait(m_epoll, events, 16, -1);
+            for (int i = 0; i < ready && !Stopped(); ++i) {
+                const int fd = events[i].data.fd;
+                if (fd == m_wakeFd) {
+                    uint64_t count = 0;
+                    if (read(m_wakeFd, &count, sizeof(count)) > 0) {
+                        RunPosted();
+                    }
+                } else if (fd == m_signalFd) {
+                    signalfd_siginfo info;
+                    while (read(m_signalFd, &info, sizeof(info)) == sizeof(info)) {
+                        LOG_INFO << "Received signal " << info.ssi_signo;
+                        std::function<void(int)> handler;
+                        {
+                            std::lock_guard<std::mutex> lock(m_mutex);
+                            handler = m_signalHandler;
+                        }
+                        handler(static_cast<int>(info.ssi_signo));
+                    }
+                } else {
+                    int timerId = 0;
+                    Task watched;
+                    {
+                        std::lock_guard<std::mutex> lock(m_mutex);
+                        for (auto &timer : m_timers) {
+                            if (timer.second.fd == fd) {
+                                timerId = timer.first;
+                            }
+                        }
+                        auto it = m_watched.find(fd);
+                        if (it != m_watched.end()) {
+                            watched = it->second;
+                        }
+                    }
+                    if (timerId != 0) {
+                        uint64_t expirations = 0;
+                        if (read(fd, &expirations, sizeof(expirations)) > 0) {
+                            RunTimer(timerId);
+                        }
+                    } else if (watched) {
+                        watched();
+                    }
+                }
+            }
+        }
+#else
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (!m_stopped) {
+            auto due = std::chrono::steady_clock::time_point::max();
+            int timerId = 0;
+            for (auto &timer : m_timers) {
+                if (timer.second.due < due) {
+                    due = timer.second.due;
+                    timerId = timer.first;
+                }
+            }
+            // Signal handlers cannot notify a condition variable, so look for them a few times a second.
+            const auto signalPoll = std::chrono::steady_clock::now() + std::chrono::milliseconds(200);
+            m_cv.wait_until(lock, std::min(due, signalPoll));
+
+            const int signal = s_pendingSignal.exchange(0);
+            const bool timerDue = timerId != 0 && std::chrono::steady_clock::now() >= due;
+            lock.unlock();
+            if (signal != 0) {
+                LOG_INFO << "Received signal " << signal;
+                std::function<void(int)> handler;
+                {
+                    std::lock_guard<std::mutex> handlerLock(m_mutex);
+                    handler = m_signalHandler;
+                }
+                handler(signal);
+            }
+            RunPosted();
+            if (timerDue) {
+                RunTimer(timerId);
+            }
+            lock.lock();
+        }
+#endif
+    }
+}
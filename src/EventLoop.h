@@ -0,0 +1,85 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace AMM {
+
+/// Single-threaded loop the main thread parks in. On Linux it sleeps in epoll on a
+/// signalfd (shutdown signals), an eventfd (work posted from other threads), one
+/// timerfd per timer and any watched descriptors, so an idle manager never wakes.
+/// Elsewhere it falls back to a condition variable and a plain signal handler.
+    class EventLoop {
+
+    public:
+        typedef std::function<void()> Task;
+
+        EventLoop();
+
+        ~EventLoop();
+
+        EventLoop(const EventLoop &) = delete;
+
+        EventLoop &operator=(const EventLoop &) = delete;
+
+        /// Routes SIGINT, SIGTERM and SIGHUP to the loop. Call before any thread is
+        /// started, so every thread inherits the blocked signal mask.
+        bool Open();
+
+        /// Called on the loop thread with the signal number; the default stops the loop.
+        void OnSignal(std::function<void(int)> handler);
+
+        /// Runs `task` on the loop thread after `delay`, then every `interval` if it is non-zero.
+        int AddTimer(std::chrono::milliseconds delay, std::chrono::milliseconds interval, Task task);
+
+        void CancelTimer(int id);
+
+        /// Runs `task` on the loop thread whenever `fd` is readable (Linux only).
+        bool Watch(int fd, Task task);
+
+        void Unwatch(int fd);
+
+        /// Queues `task` for the loop thread; safe from any thread.
+        void Post(Task task);
+
+        /// Makes Run() return once the current task finishes; safe from any thread.
+        void Stop();
+
+        bool Stopped() const;
+
+        void Run();
+
+    private:
+        struct Timer {
+            int fd = -1;
+            std::chrono::steady_clock::time_point due;
+            std::chrono::milliseconds interval{0};
+            Task task;
+        };
+
+        void RunPosted();
+
+        void RunTimer(int id);
+
+        void Wake();
+
+        mutable std::mutex m_mutex;
+        std::condition_variable m_cv;
+        std::vector<Task> m_posted;
+        std::map<int, Timer> m_timers;
+        std::map<int, Task> m_watched;
+        std::function<void(int)> m_signalHandler;
+        int m_nextTimer = 1;
+        bool m_stopped = false;
+
+        int m_epoll = -1;
+        int m_signalFd = -1;
+        int m_wakeFd = -1;
+    };
+
+} // namespace AMM
@@ -0,0 +1,180 @@
+#include "LatencyHistogram.h"
+
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+namespace AMM {
+    namespace {
+        int HighestBit(uint64_t value) {
+            int bit = 0;
+            while (value >>= 1) {
+                ++bit;
+            }
+            return bit;
+        }
+
+        /// Formats nanoseconds with a unit that keeps the number readable.
+        std::string FormatDuration(uint64_t ns) {
+            std::ostringstream out;
+            out << std::fixed << std::setprecision(1);
+            if (ns < 10000) {
+                out << ns << "ns";
+            } else if (ns < 10000000) {
+                out << ns / 1000.0 << "us";
+            } else if (ns < 10000000000ULL) {
+                out << ns / 1000000.0 << "ms";
+            } else {
+                out << ns / 1000000000.0 << "s";
+            }
+            return out.str();
+        }
+    }
+
+    LatencyHistogram::LatencyHistogram() : m_total(0), m_sum(0), m_max(0) {
+        for (std::atomic<uint64_t> &count : m_counts) {
+            count.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    int LatencyHistogram::BucketIndex(uint64_t value) {
+        if (value < static_cast<uint64_t>(SubBucketCount)) {
+            return static_cast<int>(value);
+        }
+        int exponent = HighestBit(value);
+        if (exponent >= MaxExponent) {
+            return BucketCount - 1;
+        }
+        int shift = exponent - SubBucketBits;
+        int subBucket = static_cast<int>(value >> shift) - SubBucketCount;
+        return SubBucketCount + shift * SubBucketCount + subBucket;
+    }
+
+    uint64_t LatencyHistogram::BucketUpperBound(int index) {
+        if (index < SubBucketCount) {
+            return static_cast<uint64_t>(index);
+        }
+        int shift = (index - SubBucketCount) / SubBucketCount;
+        uint64_t mantissa = static_cast<uint64_t>((index - SubBucketCount) % SubBucketCount + SubBucketCount);
+        return ((mantissa + 1) << shift) - 1;
+    }
+
+    void LatencyHistogram::Record(int64_t nanoseconds, uint64_t count) {
+        uint64_t value = nanoseconds > 0 ? static_cast<uint64_t>(nanoseconds) : 0;
+        m_counts[BucketIndex(value)].fetch_add(count, std::memory_order_relaxed);
+        m_total.fetch_add(count, std::memory_order_relaxed);
+        m_sum.fetch_add(value * count, std::memory_order_relaxed);
+
+        uint64_t max = m_max.load(std::memory_order_relaxed);
+        while (value > max && !m_max.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+        }
+    }
+
+    LatencyHistogram::Snapshot LatencyHistogram::Take() const {
+        Snapshot snapshot;
+        snapshot.counts.resize(BucketCount);
+        for (int i = 0; i < BucketCount; ++i) {
+            snapshot.counts[i] = m_counts[i].load(std::memory_order_relaxed);
+            snapshot.total += snapshot.counts[i];
+        }
+        // The total is summed from the buckets so percentiles stay consistent while recording continues.
+        snapshot.sum = m_sum.load(std::memory_order_relaxed);
+        snapshot.max = m_max.load(std::memory_order_relaxed);
+        return snapshot;
+    }
+
+    uint64_t LatencyHistogram::Snapshot::Percentile(double percent) const {
+        if (total == 0) {
+            return 0;
+        }
+        uint64_t rank = static_cast<uint64_t>(percent / 100.0 * static_cast<double>(total) + 0.5);
+        if (rank < 1) {
+            rank = 1;
+        }
+        uint64_t seen = 0;
+        for (std::size_t i = 0; i < counts.size(); ++i) {
+            seen += counts[i];
+            if (seen >= rank) {
+                uint64_t bound = BucketUpperBound(static_cast<int>(i));
+                return bound < max ? bound : max;
+            }
+        }
+        return max;
+    }
+
+    const char *LatencyStageName(LatencyStage stage) {
+        switch (stage) {
+            case LatencyStage::SourceToCallback:
+                return "source->callback";
+            case LatencyStage::CallbackToDequeue:
+                return "callback->dequeue";
+            case LatencyStage::DequeueToCommit:
+                return "dequeue->commit";
+            default:
+                return "unknown";
+        }
+    }
+
+    void LatencyStats::PrintSummary(std::ostream &os) const {
+        os << std::left << std::setw(26) << "Topic" << std::setw(19) << "Stage"
+           << std::right << std::setw(10) << "Count" << std::setw(10) << "Mean" << std::setw(10) << "p50"
+           << std::setw(10) << "p99" << std::setw(10) << "p99.9" << std::setw(10) << "Max" << std::endl;
+
+        for (std::size_t topic = 0; topic < TopicCount; ++topic) {
+            for (std::size_t stage = 0; stage < LatencyStageCount; ++stage) {
+                LatencyHistogram::Snapshot snapshot = m_histograms[topic][stage].Take();
+                if (snapshot.total == 0) {
+                    continue;
+                }
+                os << std::left << std::setw(26) << TopicName(static_cast<TopicId>(topic))
+                   << std::setw(19) << LatencyStageName(static_cast<LatencyStage>(stage))
+                   << std::right << std::setw(10) << snapshot.total
+                   << std::setw(10) << FormatDuration(snapshot.Mean())
+                   << std::setw(10) << FormatDuration(snapshot.Percentile(50.0))
+                   << std::setw(10) << FormatDuration(snapshot.Percentile(99.0))
+                   << std::setw(10) << FormatDuration(snapshot.Percentile(99.9))
+                   << std::setw(10) << FormatDuration(snapshot.max) << std::endl;
+            }
+        }
+    }
+
+    void LatencyStats::PrintDistribution(std::ostream &os) const {
+        for (std::size_t topic = 0; topic < TopicCount; ++topic) {
+            for (std::size_t stage = 0; stage < LatencyStageCount; ++stage) {
+                LatencyHistogram::Snapshot snapshot = m_histograms[topic][stage].Take();
+                if (snapshot.total == 0) {
+                    continue;
+                }
+                os << "# " << TopicName(static_cast<TopicId>(topic)) << " "
+                   << LatencyStageName(static_cast<LatencyStage>(stage)) << std::endl;
+                os << std::setw(16) << "Value(ns)" << std::setw(14) << "Percentile"
+                   << std::setw(12) << "TotalCount" << std::endl;
+
+                uint64_t seen = 0;
+                for (std::size_t i = 0; i < snapshot.counts.size(); ++i) {
+                    if (snapshot.counts[i] == 0) {
+                        continue;
+                    }
+                    seen += snapshot.counts[i];
+                    os << std::setw(16) << LatencyHistogram::BucketUpperBound(static_cast<int>(i))
+                       << std::setw(14) << std::fixed << std::setprecision(6)
+                       << static_cast<double>(seen) / static_cast<double>(snapshot.total)
+                       << std::setw(12) << seen << std::endl;
+                }
+                os << "#[Mean = " << snapshot.Mean() << ", Max = " << snapshot.max
+                   << ", Total count = " << snapshot.total << "]" << std::endl << std::endl;
+            }
+        }
+    }
+
+    bool LatencyStats::Dump(const std::string &fileName) const {
+        std::ofstream out(fileName);
+        if (!out) {
+            return false;
+        }
+        PrintSummary(out);
+        out << std::endl;
+        PrintDistribution(out);
+        return static_cast<bool>(out);
+    }
+}
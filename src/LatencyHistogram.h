@@ -0,0 +1,100 @@
+#pragma once
+
+#include "Topics.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace AMM {
+
+/// Lock-free, log-linear latency histogram in the style of HdrHistogram.
+/// Values are nanoseconds; every power of two is split into 16 linear
+/// sub-buckets, which bounds the error of any reported value to ~6%.
+/// Recording is a handful of relaxed atomic adds and never allocates.
+    class LatencyHistogram {
+
+    public:
+        static const int SubBucketBits = 4;
+        static const int SubBucketCount = 1 << SubBucketBits;
+
+        /// Values at or above 2^MaxExponent ns (about 39 hours) land in the last bucket.
+        static const int MaxExponent = 47;
+        static const int BucketCount = SubBucketCount * (MaxExponent - SubBucketBits + 1);
+
+        /// Point-in-time copy of a histogram, safe to inspect at leisure.
+        struct Snapshot {
+            std::vector<uint64_t> counts;
+            uint64_t total = 0;
+            uint64_t sum = 0;
+            uint64_t max = 0;
+
+            /// Highest value below which the given percentage (0-100) of samples fall.
+            uint64_t Percentile(double percent) const;
+
+            uint64_t Mean() const { return total == 0 ? 0 : sum / total; }
+        };
+
+        LatencyHistogram();
+
+        LatencyHistogram(const LatencyHistogram &) = delete;
+
+        LatencyHistogram &operator=(const LatencyHistogram &) = delete;
+
+        /// Records a latency; negative values (clock skew between hosts) count as zero.
+        void Record(int64_t nanoseconds, uint64_t count = 1);
+
+        Snapshot Take() const;
+
+        static int BucketIndex(uint64_t value);
+
+        /// Largest value that maps to the given bucket.
+        static uint64_t BucketUpperBound(int index);
+
+    private:
+        std::array<std::atomic<uint64_t>, BucketCount> m_counts;
+        std::atomic<uint64_t> m_total;
+        std::atomic<uint64_t> m_sum;
+        std::atomic<uint64_t> m_max;
+    };
+
+/// Stages a sample passes through between its publisher and amm.db.
+    enum class LatencyStage : uint8_t {
+        SourceToCallback = 0,
+        CallbackToDequeue,
+        DequeueToCommit,
+        Count
+    };
+
+    const std::size_t LatencyStageCount = static_cast<std::size_t>(LatencyStage::Count);
+
+    const char *LatencyStageName(LatencyStage stage);
+
+/// One histogram per topic and pipeline stage.
+    class LatencyStats {
+
+    public:
+        void Record(TopicId topic, LatencyStage stage, int64_t nanoseconds, uint64_t count = 1) {
+            m_histograms[static_cast<std::size_t>(topic)][static_cast<std::size_t>(stage)].Record(nanoseconds, count);
+        }
+
+        const LatencyHistogram &Get(TopicId topic, LatencyStage stage) const {
+            return m_histograms[static_cast<std::size_t>(topic)][static_cast<std::size_t>(stage)];
+        }
+
+        /// Percentile summary of every histogram that has samples.
+        void PrintSummary(std::ostream &os) const;
+
+        /// Full percentile distribution of every histogram, HdrHistogram .hgrm style.
+        void PrintDistribution(std::ostream &os) const;
+
+        bool Dump(const std::string &fileName) const;
+
+    private:
+        LatencyHistogram m_histograms[TopicCount][LatencyStageCount];
+    };
+
+} // namespace AMM
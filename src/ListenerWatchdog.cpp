@@ -0,0 +1,231 @@
+#include "ListenerWatchdog.h"
+
+#include "Clock.h"
+#include "ThreadPlacement.h"
+#include "Tracer.h"
+
+#include "plog/Log.h"
+
+#include <algorithm>
+#include <iomanip>
+
+namespace AMM {
+    namespace {
+        const std::chrono::milliseconds DefaultBudget(100);
+        const std::chrono::milliseconds MinPollInterval(5);
+
+        std::atomic<uint64_t> s_nextId(1);
+
+        double ToMs(int64_t ns) {
+            return static_cast<double>(ns) / 1e6;
+        }
+    }
+
+    ListenerWatchdog::ListenerWatchdog(MetricsRegistry *metrics)
+            : m_id(s_nextId.fetch_add(1, std::memory_order_relaxed)),
+              m_budget(std::chrono::duration_cast<std::chrono::nanoseconds>(DefaultBudget).count()) {
+        if (metrics != nullptr) {
+            for (std::size_t i = 0; i < TopicCount; ++i) {
+                const MetricLabels labels{{"topic", TopicName(static_cast<TopicId>(i))}};
+                m_duration[i] = &metrics->AddHistogram("amm_listener_duration_seconds",
+                                                       "Time spent in one subscription callback.", labels,
+                                                       {0.0001, 0.0005, 0.001, 0.005, 0.01, 0.05, 0.1, 0.5, 1});
+                m_overruns[i] = &metrics->AddCounter("amm_listener_overruns_total",
+                                                     "Subscription callbacks that exceeded the listener budget.",
+                                                     labels);
+            }
+        }
+    }
+
+    ListenerWatchdog::~ListenerWatchdog() {
+        Stop();
+    }
+
+    void ListenerWatchdog::Start() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_running) {
+            return;
+        }
+        m_running = true;
+        m_thread = std::thread(&ListenerWatchdog::Run, this);
+    }
+
+    void ListenerWatchdog::Stop() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_running) {
+                return;
+            }
+            m_running = false;
+        }
+        m_cv.notify_one();
+        if (m_thread.joinable()) {
+            m_thread.join();
+        }
+    }
+
+    void ListenerWatchdog::SetBudget(std::chrono::milliseconds budget) {
+        m_budget.store(std::chrono::duration_cast<std::chrono::nanoseconds>(budget).count(),
+                       std::memory_order_relaxed);
+        m_cv.notify_one();
+    }
+
+    std::chrono::milliseconds ListenerWatchdog::Budget() const {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::nanoseconds(m_budget.load(std::memory_order_relaxed)));
+    }
+
+    ListenerWatchdog::Slot &ListenerWatchdog::LocalSlot() {
+        thread_local std::shared_ptr<Slot> slot;
+        thread_local uint64_t owner = 0;
+        if (owner != m_id) {
+            slot = std::make_shared<Slot>();
+            owner = m_id;
+            Tracer::PublishContext(&slot->context);
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_slots.push_back(slot);
+        }
+        return *slot;
+    }
+
+    void ListenerWatchdog::Begin(TopicId topic) {
+        Slot &slot = LocalSlot();
+        slot.topic.store(static_cast<uint8_t>(topic), std::memory_order_relaxed);
+        slot.sequence.fetch_add(1, std::memory_order_relaxed);
+        slot.start.store(Clock::NowNs(), std::memory_order_release);
+        // Both sides are sequentially consistent: either we see the watchdog going idle, or it
+        // sees this callback before it sleeps. Only the first callback after a lull takes the lock.
+        m_active.fetch_add(1);
+        if (m_idle.load()) {
+            Wake();
+        }
+    }
+
+    void ListenerWatchdog::Wake() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_idle.store(false, std::memory_order_relaxed);
+        }
+        m_cv.notify_one();
+    }
+
+    void ListenerWatchdog::End() {
+        Slot &slot = LocalSlot();
+        const int64_t start = slot.start.load(std::memory_order_relaxed);
+        const int64_t duration = Clock::NowNs() - start;
+        slot.start.store(0, std::memory_order_release);
+        m_active.fetch_sub(1, std::memory_order_release);
+
+        const std::size_t topicIndex = slot.topic.load(std::memory_order_relaxed);
+        if (m_duration[topicIndex] != nullptr) {
+            m_duration[topicIndex]->Observe(static_cast<double>(duration) / 1e9);
+        }
+        if (duration <= m_budget.load(std::memory_order_relaxed)) {
+            return;
+        }
+
+        if (m_overruns[topicIndex] != nullptr) {
+            m_overruns[topicIndex]->Increment();
+        }
+        Invocation invocation{static_cast<TopicId>(topicIndex), Clock::WallNs() - duration, duration, std::string()};
+        const uint64_t sequence = slot.sequence.load(std::memory_order_relaxed);
+        if (slot.flagged.load(std::memory_order_acquire) == sequence) {
+            const char *context = slot.flaggedContext.load(std::memory_order_relaxed);
+            invocation.context = context != nullptr ? context : "";
+        }
+        LOG_WARNING << "Listener for " << TopicName(invocation.topic) << " took " << ToMs(duration)
+                    << " ms (budget " << Budget().count() << " ms)";
+        RecordSlow(invocation);
+    }
+
+    void ListenerWatchdog::RecordSlow(const Invocation &invocation) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_slowest.size() == SlowestCount && m_slowest.back().duration >= invocation.duration) {
+            return;
+        }
+        auto at = std::upper_bound(m_slowest.begin(), m_slowest.end(), invocation,
+                                   [](const Invocation &a, const Invocation &b) {
+                                       return a.duration > b.duration;
+                                   });
+        m_slowest.insert(at, invocation);
+        if (m_slowest.size() > SlowestCount) {
+            m_slowest.pop_back();
+        }
+    }
+
+    std::vector<ListenerWatchdog::Invocation> ListenerWatchdog::Slowest() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_slowest;
+    }
+
+    void ListenerWatchdog::PrintSlowest(std::ostream &os) const {
+        const std::vector<Invocation> slowest = Slowest();
+        if (slowest.empty()) {
+            os << "No listener callbacks over the " << Budget().count() << " ms budget." << std::endl;
+            return;
+        }
+        const std::ios::fmtflags flags = os.flags();
+        os << std::left << std::setw(28) << "topic" << std::right << std::setw(12) << "ms"
+           << std::setw(16) << "started (ms)" << "  context" << std::endl;
+        os << std::fixed << std::setprecision(3);
+        for (const Invocation &invocation : slowest) {
+            os << std::left << std::setw(28) << TopicName(invocation.topic) << std::right
+               << std::setw(12) << ToMs(invocation.duration)
+               << std::setw(16) << Clock::ToMs(invocation.started)
+               << "  " << (invocation.context.empty() ? "-" : invocation.context) << std::endl;
+        }
+        os.flags(flags);
+    }
+
+    void ListenerWatchdog::Check(Slot &slot, int64_t now, int64_t budget) {
+        const uint64_t sequence = slot.sequence.load(std::memory_order_relaxed);
+        const int64_t start = slot.start.load(std::memory_order_acquire);
+        if (start == 0 || now - start <= budget || slot.flagged.load(std::memory_order_relaxed) == sequence) {
+            return;
+        }
+        const char *context = slot.context.load(std::memory_order_relaxed);
+        // The callback may have finished and another begun while we looked; skip rather than misreport.
+        if (slot.sequence.load(std::memory_order_acquire) != sequence) {
+            return;
+        }
+        const TopicId topic = static_cast<TopicId>(slot.topic.load(std::memory_order_relaxed));
+        slot.flaggedContext.store(context, std::memory_order_relaxed);
+        slot.flagged.store(sequence, std::memory_order_release);
+        LOG_WARNING << "Listener for " << TopicName(topic) << " stalled for " << ToMs(now - start)
+                    << " ms in " << (context != nullptr ? context : "an untraced section");
+    }
+
+    void ListenerWatchdog::Run() {
+        ThreadPlacement::Apply(ThreadRole::Maintenance, "listener-watchdog");
+        std::vector<std::shared_ptr<Slot>> slots;
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (m_running) {
+            m_idle.store(true);
+            if (m_active.load() == 0) {
+                m_cv.wait(lock, [this] { return !m_running || !m_idle.load(std::memory_order_relaxed); });
+            }
+            m_idle.store(false, std::memory_order_relaxed);
+            if (!m_running) {
+                break;
+            }
+
+            const int64_t budget = m_budget.load(std::memory_order_relaxed);
+            const std::chrono::milliseconds interval =
+                    std::max(MinPollInterval, std::chrono::duration_cast<std::chrono::milliseconds>(
+                            std::chrono::nanoseconds(budget / 2)));
+            m_cv.wait_for(lock, interval);
+            if (!m_running) {
+                break;
+            }
+            slots = m_slots;
+            lock.unlock();
+
+            const int64_t now = Clock::NowNs();
+            for (const std::shared_ptr<Slot> &slot : slots) {
+                Check(*slot, now, budget);
+            }
+            lock.lock();
+        }
+    }
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "Metrics.h"
+#include "Topics.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace AMM {
+
+/// Times every subscription callback and watches for ones that overrun their budget.
+/// Listener threads publish what they are running through their own slot, so timing a
+/// callback is a few relaxed stores; a separate thread polls the slots while any callback
+/// is running and reports one still running past the budget, along with the innermost
+/// TraceSpan it is in. With no callback running it sleeps until the next one begins.
+/// Callbacks that finish over budget are kept in a table of the slowest.
+    class ListenerWatchdog {
+
+    public:
+        static const std::size_t SlowestCount = 10;
+
+        struct Invocation {
+            TopicId topic;
+            /// Wall clock time the callback started.
+            int64_t started;
+            int64_t duration;
+            /// Span the callback was in when the watchdog caught it, if it did.
+            std::string context;
+        };
+
+        /// Marks the enclosing scope as a callback for a topic.
+        class Scope {
+
+        public:
+            Scope(ListenerWatchdog &watchdog, TopicId topic) : m_watchdog(watchdog) { m_watchdog.Begin(topic); }
+
+            ~Scope() { m_watchdog.End(); }
+
+            Scope(const Scope &) = delete;
+
+            Scope &operator=(const Scope &) = delete;
+
+        private:
+            ListenerWatchdog &m_watchdog;
+        };
+
+        explicit ListenerWatchdog(MetricsRegistry *metrics = nullptr);
+
+        ~ListenerWatchdog();
+
+        ListenerWatchdog(const ListenerWatchdog &) = delete;
+
+        ListenerWatchdog &operator=(const ListenerWatchdog &) = delete;
+
+        void Start();
+
+        void Stop();
+
+        void SetBudget(std::chrono::milliseconds budget);
+
+        std::chrono::milliseconds Budget() const;
+
+        void Begin(TopicId topic);
+
+        void End();
+
+        /// Slowest over-budget callbacks, longest first.
+        std::vector<Invocation> Slowest() const;
+
+        void PrintSlowest(std::ostream &os) const;
+
+    private:
+        struct Slot {
+            std::atomic<uint64_t> sequence{0};
+            std::atomic<int64_t> start{0};
+            std::atomic<uint8_t> topic{0};
+            std::atomic<const char *> context{nullptr};
+            /// Set by the watchdog thread once it has reported an invocation.
+            std::atomic<uint64_t> flagged{0};
+            std::atomic<const char *> flaggedContext{nullptr};
+        };
+
+        Slot &LocalSlot();
+
+        void Run();
+
+        /// Wakes the watchdog thread from its idle wait.
+        void Wake();
+
+        void Check(Slot &slot, int64_t now, int64_t budget);
+
+        void RecordSlow(const Invocation &invocation);
+
+        /// Distinguishes this watchdog from earlier ones in the thread-local slot cache.
+        const uint64_t m_id;
+
+        std::atomic<int64_t> m_budget;
+
+        /// Callbacks in progress, and whether the watchdog thread is in (or entering) its idle wait.
+        std::atomic<int> m_active{0};
+        std::atomic<bool> m_idle{false};
+
+        mutable std::mutex m_mutex;
+        std::condition_variable m_cv;
+        std::thread m_thread;
+        bool m_running = false;
+        std::vector<std::shared_ptr<Slot>> m_slots;
+        std::vector<Invocation> m_slowest;
+
+        Histogram *m_duration[TopicCount] = {};
+        Counter *m_overruns[TopicCount] = {};
+    };
+
+} // namespace AMM
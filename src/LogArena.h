@@ -0,0 +1,87 @@
+#pragma once
+
+#include <boost/utility/string_view.hpp>
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace AMM {
+
+/// Bump allocator backing the strings of one batch of log entries.
+/// Reset() rewinds without releasing blocks, so once the arena has grown to
+/// the working-set size of a batch it stops touching the heap.
+    class LogArena {
+
+    public:
+        explicit LogArena(std::size_t blockSize = 64 * 1024) : m_blockSize(blockSize) {}
+
+        LogArena(const LogArena &) = delete;
+
+        LogArena &operator=(const LogArena &) = delete;
+
+        /// Copies a string into the arena and returns a view of the copy.
+        boost::string_view Store(boost::string_view value) {
+            if (value.empty()) {
+                return boost::string_view();
+            }
+            char *dest = Allocate(value.size());
+            std::memcpy(dest, value.data(), value.size());
+            return boost::string_view(dest, value.size());
+        }
+
+        char *Allocate(std::size_t size) {
+            while (m_current < m_blocks.size()) {
+                Block &block = m_blocks[m_current];
+                if (block.size - m_offset >= size) {
+                    char *result = block.data.get() + m_offset;
+                    m_offset += size;
+                    m_used += size;
+                    return result;
+                }
+                ++m_current;
+                m_offset = 0;
+            }
+
+            Block block;
+            block.size = size > m_blockSize ? size : m_blockSize;
+            block.data.reset(new char[block.size]);
+            m_blocks.push_back(std::move(block));
+            m_current = m_blocks.size() - 1;
+            m_offset = size;
+            m_used += size;
+            return m_blocks.back().data.get();
+        }
+
+        /// Rewinds the arena; every view handed out so far becomes invalid.
+        void Reset() {
+            m_current = 0;
+            m_offset = 0;
+            m_used = 0;
+        }
+
+        std::size_t BytesUsed() const { return m_used; }
+
+        std::size_t BytesReserved() const {
+            std::size_t total = 0;
+            for (const Block &block : m_blocks) {
+                total += block.size;
+            }
+            return total;
+        }
+
+    private:
+        struct Block {
+            std::unique_ptr<char[]> data;
+            std::size_t size = 0;
+        };
+
+        std::size_t m_blockSize;
+        std::vector<Block> m_blocks;
+        std::size_t m_current = 0;
+        std::size_t m_offset = 0;
+        std::size_t m_used = 0;
+    };
+
+} // namespace AMM
@@ -0,0 +1,334 @@
+#include "LogWriter.h"
+
+#include "SqlProfiler.h"
+#include "ThreadPlacement.h"
+#include "Tracer.h"
+
+#include "plog/Log.h"
+
+#include <sqlite3.h>
+
+#include <chrono>
+
+namespace AMM {
+    namespace {
+        /// How long a batch may sit before it is committed even if it is small.
+        const std::chrono::milliseconds FlushInterval(50);
+
+        /// Longest a listener waits on a full batch before its entry is dropped.
+        const std::chrono::milliseconds MaxWriteStall(100);
+
+        /// Retries a locked database for up to a second, unless a drain has given up on the writer.
+        int BusyWait(void *abandon, int attempts) {
+            if (static_cast<std::atomic<bool> *>(abandon)->load() || attempts >= 200) {
+                return 0;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            return 1;
+        }
+
+        void BindText(sqlite3_stmt *stmt, int index, boost::string_view value) {
+            // Entries outlive the step, so SQLite can reference the arena directly.
+            sqlite3_bind_text(stmt, index, value.data(), static_cast<int>(value.size()), SQLITE_STATIC);
+        }
+    }
+
+    LogWriter::LogWriter(const std::string &dbPath, std::mutex &dbMutex, LatencyStats *latency,
+                         MetricsRegistry *metrics, std::size_t batchCapacity)
+            : m_dbPath(dbPath), m_dbMutex(dbMutex), m_latency(latency), m_capacity(batchCapacity) {
+        m_batches[0].entries.reserve(m_capacity);
+        m_batches[1].entries.reserve(m_capacity);
+
+        if (metrics != nullptr) {
+            m_committed = &metrics->AddCounter("amm_events_committed_total",
+                                               "Event rows committed to the events table.");
+            m_droppedCount = &metrics->AddCounter("amm_events_dropped_total",
+                                                  "Event rows dropped because the log batch stayed full.");
+            m_commitErrors = &metrics->AddCounter("amm_events_commit_errors_total",
+                                                  "Event rows or batches that failed to commit.");
+            metrics->AddGauge("amm_event_queue_depth", "Event rows waiting for the next commit.", {},
+                              [this] { return static_cast<double>(Pending()); });
+            metrics->AddGauge("amm_event_queue_capacity", "Event rows a batch can hold.", {},
+                              [this] { return static_cast<double>(m_capacity); });
+            m_batchSizes = &metrics->AddHistogram("amm_event_batch_size", "Event rows per committed batch.", {},
+                                                  {1, 4, 16, 64, 256, 1024, 4096});
+            m_commitSeconds = &metrics->AddHistogram("amm_event_commit_duration_seconds",
+                                                     "Time to commit one batch of event rows.", {},
+                                                     {0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1,
+                                                      0.25, 0.5, 1});
+        }
+    }
+
+    LogWriter::~LogWriter() {
+        Stop();
+    }
+
+    void LogWriter::Start() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_running) {
+            return;
+        }
+        m_running = true;
+        m_finished = false;
+        m_abandon = false;
+        m_thread = std::thread(&LogWriter::Run, this);
+    }
+
+    void LogWriter::Stop() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_running) {
+                return;
+            }
+            m_running = false;
+        }
+        m_cv.notify_one();
+        if (m_thread.joinable()) {
+            m_thread.join();
+        }
+    }
+
+    bool LogWriter::Drain(std::chrono::milliseconds deadline) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_running) {
+                return m_failedRows == 0;
+            }
+            m_running = false;
+        }
+        m_cv.notify_one();
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (!m_finishedCv.wait_for(lock, deadline, [this] { return m_finished; })) {
+            LOG_WARNING << "Log writer missed its " << deadline.count() << " ms drain deadline, abandoning "
+                        << m_active->entries.size() << " queued entries and the commit in progress.";
+            m_abandon = true;
+            lock.unlock();
+            {
+                std::lock_guard<std::mutex> dbLock(m_interruptMutex);
+                if (m_db != nullptr) {
+                    sqlite3_interrupt(m_db);
+                }
+            }
+            lock.lock();
+        }
+        const bool complete = !m_abandon && m_failedRows == 0;
+        lock.unlock();
+
+        if (m_thread.joinable()) {
+            m_thread.join();
+        }
+        return complete;
+    }
+
+    bool LogWriter::Write(LogEntry &&entry) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (!m_running && m_finished) {
+            // The writer has drained; nothing would ever commit this.
+            ++m_dropped;
+            if (m_droppedCount != nullptr) {
+                m_droppedCount->Increment();
+            }
+            return false;
+        }
+        if (m_active->entries.size() >= m_capacity) {
+            // Hold the listener briefly rather than lose the event; the writer
+            // frees a whole batch at once when it swaps.
+            m_cv.notify_one();
+            m_spaceCv.wait_for(lock, MaxWriteStall, [this] {
+                return m_active->entries.size() < m_capacity;
+            });
+            if (m_active->entries.size() >= m_capacity) {
+                if (m_droppedCount != nullptr) {
+                    m_droppedCount->Increment();
+                }
+                if (m_dropped++ % 1000 == 0) {
+                    LOG_WARNING << "Log batch is full, dropping entries (" << m_dropped << " so far).";
+                }
+                return false;
+            }
+        }
+
+        Batch &batch = *m_active;
+
+        entry.source = batch.arena.Store(entry.source);
+        entry.event_id = batch.arena.Store(entry.event_id);
+        entry.data = batch.arena.Store(entry.data);
+        batch.entries.push_back(std::move(entry));
+
+        bool wake = batch.entries.size() >= m_capacity / 2;
+        lock.unlock();
+        if (wake) {
+            m_cv.notify_one();
+        }
+        return true;
+    }
+
+    uint64_t LogWriter::Dropped() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_dropped;
+    }
+
+    uint64_t LogWriter::Committed() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_committedRows;
+    }
+
+    uint64_t LogWriter::Failed() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_failedRows;
+    }
+
+    std::size_t LogWriter::Pending() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_active->entries.size();
+    }
+
+    void LogWriter::Run() {
+        ThreadPlacement::Apply(ThreadRole::Writer, "log-writer");
+        if (!Open()) {
+            LOG_ERROR << "Log writer could not open " << m_dbPath << ", events will not be stored.";
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true) {
+            m_cv.wait_for(lock, FlushInterval, [this] {
+                return !m_running || m_active->entries.size() >= m_capacity / 2;
+            });
+
+            bool finished = !m_running;
+            std::swap(m_active, m_standby);
+            Batch &batch = *m_standby;
+            const int64_t dequeueTime = Clock::NowNs();
+
+            lock.unlock();
+            m_spaceCv.notify_all();
+            const std::size_t stored = Commit(batch, dequeueTime);
+            lock.lock();
+            m_committedRows += stored;
+            m_failedRows += batch.entries.size() - stored;
+            batch.entries.clear();
+            batch.arena.Reset();
+
+            if (m_abandon) {
+                m_failedRows += m_active->entries.size();
+                m_active->entries.clear();
+                m_active->arena.Reset();
+            }
+            if (finished && m_active->entries.empty()) {
+                break;
+            }
+        }
+        lock.unlock();
+
+        Close();
+
+        lock.lock();
+        m_finished = true;
+        lock.unlock();
+        m_finishedCv.notify_all();
+    }
+
+    std::size_t LogWriter::Commit(Batch &batch, int64_t dequeueTime) {
+        if (batch.entries.empty() || m_insert == nullptr || m_abandon) {
+            return 0;
+        }
+
+        TraceSpan span("CommitEvents", "db");
+        std::lock_guard<std::mutex> dbLock(m_dbMutex);
+        const int64_t commitTime = Clock::NowNs();
+        sqlite3_exec(m_db, "begin;", nullptr, nullptr, nullptr);
+        std::size_t stored = 0;
+        for (const LogEntry &entry : batch.entries) {
+            if (m_abandon) {
+                break;
+            }
+            const std::string &topic = TopicName(entry.topic);
+            BindText(m_insert, 1, entry.source);
+            BindText(m_insert, 2, topic);
+            BindText(m_insert, 3, entry.event_id);
+            sqlite3_bind_int64(m_insert, 4, static_cast<sqlite3_int64>(entry.timestamp));
+            BindText(m_insert, 5, entry.data);
+            sqlite3_bind_int64(m_insert, 6, entry.module_key);
+            sqlite3_bind_int64(m_insert, 7, entry.times.source);
+            sqlite3_bind_int64(m_insert, 8, entry.times.receive);
+            sqlite3_bind_int64(m_insert, 9, commitTime);
+
+            if (sqlite3_step(m_insert) == SQLITE_DONE) {
+                ++stored;
+            } else {
+                LOG_ERROR << sqlite3_errmsg(m_db);
+                if (m_commitErrors != nullptr) {
+                    m_commitErrors->Increment();
+                }
+            }
+            sqlite3_reset(m_insert);
+        }
+        sqlite3_clear_bindings(m_insert);
+        if (m_abandon || sqlite3_exec(m_db, "commit;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+            if (!m_abandon) {
+                LOG_ERROR << sqlite3_errmsg(m_db);
+            }
+            sqlite3_exec(m_db, "rollback;", nullptr, nullptr, nullptr);
+            if (m_commitErrors != nullptr) {
+                m_commitErrors->Increment();
+            }
+            return 0;
+        }
+
+        const int64_t committed = Clock::NowNs();
+        if (m_committed != nullptr) {
+            m_committed->Increment(stored);
+            m_batchSizes->Observe(static_cast<double>(batch.entries.size()));
+            m_commitSeconds->Observe(static_cast<double>(committed - commitTime) / 1e9);
+        }
+        if (m_latency != nullptr) {
+            for (const LogEntry &entry : batch.entries) {
+                m_latency->Record(entry.topic, LatencyStage::CallbackToDequeue, dequeueTime - entry.times.receive);
+                m_latency->Record(entry.topic, LatencyStage::DequeueToCommit, committed - dequeueTime);
+            }
+        }
+        return stored;
+    }
+
+    bool LogWriter::Open() {
+        // Preparing reads the schema, so it must not race the manager's own connection.
+        std::lock_guard<std::mutex> dbLock(m_dbMutex);
+        int flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE;
+        sqlite3 *db = nullptr;
+        const int opened = sqlite3_open_v2(m_dbPath.c_str(), &db, flags, nullptr);
+        {
+            std::lock_guard<std::mutex> lock(m_interruptMutex);
+            m_db = db;
+        }
+        if (opened != SQLITE_OK) {
+            LOG_ERROR << sqlite3_errmsg(m_db);
+            Close();
+            return false;
+        }
+        sqlite3_busy_handler(m_db, &BusyWait, &m_abandon);
+        SqlProfiler::Attach(m_db);
+
+        const char *sql = "insert into events (source, topic, event_id, timestamp, data, module_key, "
+                          "source_time, receive_time, commit_time) values (?,?,?,?,?,?,?,?,?);";
+        if (sqlite3_prepare_v2(m_db, sql, -1, &m_insert, nullptr) != SQLITE_OK) {
+            LOG_ERROR << sqlite3_errmsg(m_db);
+            Close();
+            return false;
+        }
+        return true;
+    }
+
+    void LogWriter::Close() {
+        if (m_insert != nullptr) {
+            sqlite3_finalize(m_insert);
+            m_insert = nullptr;
+        }
+        std::lock_guard<std::mutex> lock(m_interruptMutex);
+        if (m_db != nullptr) {
+            SqlProfiler::Detach(m_db);
+            sqlite3_close_v2(m_db);
+            m_db = nullptr;
+        }
+    }
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "Clock.h"
+#include "LatencyHistogram.h"
+#include "LogArena.h"
+#include "Metrics.h"
+#include "Topics.h"
+
+#include <boost/utility/string_view.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct sqlite3;
+struct sqlite3_stmt;
+
+namespace AMM {
+
+/// Definition for Logs.
+/// The views only need to live until LogWriter::Write returns; the writer
+/// copies them into the arena of the batch they are committed with.
+    struct LogEntry {
+        boost::string_view source;
+        uint32_t module_key;
+        TopicId topic;
+        boost::string_view event_id;
+        uint64_t timestamp;
+        boost::string_view data;
+        SampleTimes times;
+    };
+
+/// Batches log entries and commits them to the events table from its own thread.
+    class LogWriter {
+
+    public:
+        LogWriter(const std::string &dbPath, std::mutex &dbMutex, LatencyStats *latency = nullptr,
+                  MetricsRegistry *metrics = nullptr, std::size_t batchCapacity = 4096);
+
+        ~LogWriter();
+
+        LogWriter(const LogWriter &) = delete;
+
+        LogWriter &operator=(const LogWriter &) = delete;
+
+        void Start();
+
+        /// Commits whatever is pending and joins the writer thread.
+        void Stop();
+
+        /// Like Stop(), but gives up once `deadline` has passed: a commit still running is
+        /// interrupted and rolled back, and its rows count as failed. Returns true if
+        /// everything queued was committed.
+        bool Drain(std::chrono::milliseconds deadline);
+
+        /// Queues an entry for the next commit, waiting briefly if the batch is full.
+        /// Returns false if the entry had to be dropped.
+        bool Write(LogEntry &&entry);
+
+        uint64_t Dropped() const;
+
+        /// Rows committed, and rows lost to failed or interrupted commits, since construction.
+        uint64_t Committed() const;
+
+        uint64_t Failed() const;
+
+        /// Entries waiting in the active batch.
+        std::size_t Pending() const;
+
+        std::size_t Capacity() const { return m_capacity; }
+
+    private:
+        struct Batch {
+            LogArena arena;
+            std::vector<LogEntry> entries;
+        };
+
+        void Run();
+
+        /// Inserts the batch in one transaction; returns the rows stored, 0 if it rolled back.
+        std::size_t Commit(Batch &batch, int64_t dequeueTime);
+
+        bool Open();
+
+        void Close();
+
+        const std::string m_dbPath;
+        std::mutex &m_dbMutex;
+        LatencyStats *m_latency;
+        Counter *m_committed = nullptr;
+        Counter *m_droppedCount = nullptr;
+        Counter *m_commitErrors = nullptr;
+        Histogram *m_batchSizes = nullptr;
+        Histogram *m_commitSeconds = nullptr;
+        const std::size_t m_capacity;
+
+        Batch m_batches[2];
+        Batch *m_active = &m_batches[0];
+        Batch *m_standby = &m_batches[1];
+
+        mutable std::mutex m_mutex;
+        std::condition_variable m_cv;
+        std::condition_variable m_spaceCv;
+        std::condition_variable m_finishedCv;
+        bool m_running = false;
+        bool m_finished = false;
+        uint64_t m_dropped = 0;
+        uint64_t m_committedRows = 0;
+        uint64_t m_failedRows = 0;
+        std::thread m_thread;
+
+        /// Set when a drain runs out of time; the writer abandons the rest of its work.
+        std::atomic<bool> m_abandon{false};
+
+        /// Guards m_db against being closed while a drain interrupts it.
+        std::mutex m_interruptMutex;
+
+        sqlite3 *m_db = nullptr;
+        sqlite3_stmt *m_insert = nullptr;
+    };
+
+} // namespace AMM
@@ -0,0 +1,292 @@
+#include "Metrics.h"
+
+#include "ThreadPlacement.h"
+
+#include "plog/Log.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <unistd.h>
+#endif
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+namespace AMM {
+    namespace {
+        std::string EscapeLabel(const std::string &value) {
+            std::string escaped;
+            escaped.reserve(value.size());
+            for (char c : value) {
+                if (c == '\\' || c == '"') {
+                    escaped.push_back('\\');
+                    escaped.push_back(c);
+                } else if (c == '\n') {
+                    escaped += "\\n";
+                } else {
+                    escaped.push_back(c);
+                }
+            }
+            return escaped;
+        }
+
+#ifdef __linux__
+        double ResidentBytes() {
+            long pages = 0;
+            std::ifstream statm("/proc/self/statm");
+            statm >> pages >> pages;
+            return static_cast<double>(pages) * static_cast<double>(sysconf(_SC_PAGESIZE));
+        }
+
+        double OpenDescriptors() {
+            DIR *dir = opendir("/proc/self/fd");
+            if (dir == nullptr) {
+                return 0;
+            }
+            double count = 0;
+            while (dirent *entry = readdir(dir)) {
+                if (entry->d_name[0] != '.') {
+                    ++count;
+                }
+            }
+            closedir(dir);
+            // Not counting the descriptor opendir itself used.
+            return count - 1;
+        }
+#endif
+
+#ifdef __GLIBC__
+        double HeapInUse() {
+#if __GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33)
+            struct mallinfo2 info = mallinfo2();
+#else
+            struct mallinfo info = mallinfo();
+#endif
+            return static_cast<double>(info.uordblks) + static_cast<double>(info.hblkhd);
+        }
+#endif
+
+        std::string FormatLabels(const MetricLabels &labels) {
+            std::string text;
+            for (const auto &label : labels) {
+                text += text.empty() ? "" : ",";
+                text += label.first + "=\"" + EscapeLabel(label.second) + "\"";
+            }
+            return text;
+        }
+
+        /// Appends an extra label (such as le) to an already formatted label set.
+        std::string WithLabel(const std::string &labels, const std::string &extra) {
+            return "{" + labels + (labels.empty() ? "" : ",") + extra + "}";
+        }
+
+        std::string Braced(const std::string &labels) {
+            return labels.empty() ? std::string() : "{" + labels + "}";
+        }
+
+        std::string FormatValue(double value) {
+            std::ostringstream out;
+            out.precision(15);
+            out << value;
+            return out.str();
+        }
+    }
+
+    Histogram::Histogram(std::vector<double> bounds)
+            : m_bounds(std::move(bounds)), m_counts(new std::atomic<uint64_t>[m_bounds.size() + 1]) {
+        std::sort(m_bounds.begin(), m_bounds.end());
+        for (std::size_t i = 0; i <= m_bounds.size(); ++i) {
+            m_counts[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    void Histogram::Observe(double value) {
+        std::size_t index = static_cast<std::size_t>(
+                std::lower_bound(m_bounds.begin(), m_bounds.end(), value) - m_bounds.begin());
+        m_counts[index].fetch_add(1, std::memory_order_relaxed);
+        m_count.fetch_add(1, std::memory_order_relaxed);
+
+        double sum = m_sum.load(std::memory_order_relaxed);
+        while (!m_sum.compare_exchange_weak(sum, sum + value, std::memory_order_relaxed)) {
+        }
+    }
+
+    MetricsRegistry::Series &MetricsRegistry::AddSeries(const std::string &name, const std::string &help, Type type,
+                                                        const MetricLabels &labels) {
+        auto it = m_index.find(name);
+        if (it == m_index.end()) {
+            it = m_index.emplace(name, m_families.size()).first;
+            m_families.push_back(Family{name, help, type, {}});
+        }
+        Family &family = m_families[it->second];
+        family.series.emplace_back();
+        family.series.back().labels = FormatLabels(labels);
+        return family.series.back();
+    }
+
+    Counter &MetricsRegistry::AddCounter(const std::string &name, const std::string &help,
+                                         const MetricLabels &labels) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_counters.emplace_back();
+        AddSeries(name, help, Type::Counter, labels).counter = &m_counters.back();
+        return m_counters.back();
+    }
+
+    void MetricsRegistry::Remove(const Counter &counter) {
+        std::lock_guard<std::mutex> renderLock(m_renderMutex);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (Family &family : m_families) {
+            family.series.erase(std::remove_if(family.series.begin(), family.series.end(),
+                                               [&counter](const Series &series) {
+                                                   return series.counter == &counter;
+                                               }), family.series.end());
+        }
+        m_counters.remove_if([&counter](const Counter &candidate) { return &candidate == &counter; });
+    }
+
+    Gauge &MetricsRegistry::AddGauge(const std::string &name, const std::string &help, const MetricLabels &labels) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_gauges.emplace_back();
+        AddSeries(name, help, Type::Gauge, labels).gauge = &m_gauges.back();
+        return m_gauges.back();
+    }
+
+    void MetricsRegistry::AddGauge(const std::string &name, const std::string &help, const MetricLabels &labels,
+                                   std::function<double()> read) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        AddSeries(name, help, Type::Gauge, labels).read = std::move(read);
+    }
+
+    void MetricsRegistry::AddProcessMetrics() {
+#ifdef __linux__
+        AddGauge("process_resident_memory_bytes", "Resident memory size in bytes.", {}, &ResidentBytes);
+        AddGauge("process_open_fds", "Number of open file descriptors.", {}, &OpenDescriptors);
+#endif
+#ifdef __GLIBC__
+        AddGauge("amm_heap_in_use_bytes", "Heap bytes allocated and not yet freed, from mallinfo.", {}, &HeapInUse);
+#endif
+    }
+
+    Histogram &MetricsRegistry::AddHistogram(const std::string &name, const std::string &help,
+                                             const MetricLabels &labels, std::vector<double> bounds) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_histograms.emplace_back(std::move(bounds));
+        AddSeries(name, help, Type::Histogram, labels).histogram = &m_histograms.back();
+        return m_histograms.back();
+    }
+
+    void MetricsRegistry::WritePrometheus(std::ostream &os) const {
+        // Render from a copy: callback gauges may take locks of their own, and
+        // those owners may be registering metrics at the same time.
+        std::lock_guard<std::mutex> renderLock(m_renderMutex);
+        std::vector<Family> families;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            families = m_families;
+        }
+
+        for (const Family &family : families) {
+            if (family.series.empty()) {
+                continue;
+            }
+            const char *type = family.type == Type::Counter ? "counter"
+                                                            : family.type == Type::Gauge ? "gauge" : "histogram";
+            os << "# HELP " << family.name << " " << family.help << "\n";
+            os << "# TYPE " << family.name << " " << type << "\n";
+
+            for (const Series &series : family.series) {
+                if (series.counter != nullptr) {
+                    os << family.name << Braced(series.labels) << " " << series.counter->Value() << "\n";
+                } else if (series.gauge != nullptr) {
+                    os << family.name << Braced(series.labels) << " " << series.gauge->Value() << "\n";
+                } else if (series.read) {
+                    os << family.name << Braced(series.labels) << " " << FormatValue(series.read()) << "\n";
+                } else if (series.histogram != nullptr) {
+                    const Histogram &histogram = *series.histogram;
+                    uint64_t cumulative = 0;
+                    for (std::size_t i = 0; i < histogram.Bounds().size(); ++i) {
+                        cumulative += histogram.BucketCount(i);
+                        os << family.name << "_bucket"
+                           << WithLabel(series.labels, "le=\"" + FormatValue(histogram.Bounds()[i]) + "\"")
+                           << " " << cumulative << "\n";
+                    }
+                    cumulative += histogram.BucketCount(histogram.Bounds().size());
+                    os << family.name << "_bucket" << WithLabel(series.labels, "le=\"+Inf\"")
+                       << " " << cumulative << "\n";
+                    os << family.name << "_sum" << Braced(series.labels) << " " << FormatValue(histogram.Sum())
+                       << "\n";
+                    os << family.name << "_count" << Braced(series.labels) << " " << cumulative << "\n";
+                }
+            }
+        }
+    }
+
+    bool MetricsRegistry::WriteFile(const std::string &fileName) const {
+        const std::string temporary = fileName + ".tmp";
+        {
+            std::ofstream out(temporary);
+            if (!out) {
+                return false;
+            }
+            WritePrometheus(out);
+            if (!out) {
+                return false;
+            }
+        }
+        return std::rename(temporary.c_str(), fileName.c_str()) == 0;
+    }
+
+    MetricsExporter::~MetricsExporter() {
+        Stop();
+    }
+
+    void MetricsExporter::Start(const std::string &fileName, std::chrono::milliseconds interval) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_running) {
+            return;
+        }
+        m_fileName = fileName;
+        m_interval = interval;
+        m_running = true;
+        m_thread = std::thread(&MetricsExporter::Run, this);
+        LOG_INFO << "Exporting metrics to " << fileName << " every " << interval.count() << "ms";
+    }
+
+    void MetricsExporter::Stop() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_running) {
+                return;
+            }
+            m_running = false;
+        }
+        m_cv.notify_one();
+        if (m_thread.joinable()) {
+            m_thread.join();
+        }
+    }
+
+    void MetricsExporter::Run() {
+        ThreadPlacement::Apply(ThreadRole::Maintenance, "metrics-exporter");
+        bool reported = false;
+        std::unique_lock<std::mutex> lock(m_mutex);
+        do {
+            lock.unlock();
+            if (!m_registry.WriteFile(m_fileName) && !reported) {
+                LOG_ERROR << "Unable to write metrics to " << m_fileName;
+                reported = true;
+            }
+            lock.lock();
+        } while (!m_cv.wait_for(lock, m_interval, [this] { return !m_running; }));
+
+        // One last write so the file reflects the final counts.
+        lock.unlock();
+        m_registry.WriteFile(m_fileName);
+    }
+}
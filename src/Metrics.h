@@ -0,0 +1,159 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace AMM {
+
+    typedef std::vector<std::pair<std::string, std::string>> MetricLabels;
+
+/// Monotonically increasing count.
+    class Counter {
+
+    public:
+        void Increment(uint64_t amount = 1) { m_value.fetch_add(amount, std::memory_order_relaxed); }
+
+        uint64_t Value() const { return m_value.load(std::memory_order_relaxed); }
+
+    private:
+        std::atomic<uint64_t> m_value{0};
+    };
+
+/// Value that can go up and down.
+    class Gauge {
+
+    public:
+        void Set(int64_t value) { m_value.store(value, std::memory_order_relaxed); }
+
+        void Add(int64_t amount) { m_value.fetch_add(amount, std::memory_order_relaxed); }
+
+        int64_t Value() const { return m_value.load(std::memory_order_relaxed); }
+
+    private:
+        std::atomic<int64_t> m_value{0};
+    };
+
+/// Prometheus-style histogram with fixed, cumulative bucket bounds.
+    class Histogram {
+
+    public:
+        explicit Histogram(std::vector<double> bounds);
+
+        void Observe(double value);
+
+        const std::vector<double> &Bounds() const { return m_bounds; }
+
+        /// Non-cumulative count of one bucket; the last bucket is +Inf.
+        uint64_t BucketCount(std::size_t index) const { return m_counts[index].load(std::memory_order_relaxed); }
+
+        uint64_t Count() const { return m_count.load(std::memory_order_relaxed); }
+
+        double Sum() const { return m_sum.load(std::memory_order_relaxed); }
+
+    private:
+        std::vector<double> m_bounds;
+        std::unique_ptr<std::atomic<uint64_t>[]> m_counts;
+        std::atomic<uint64_t> m_count{0};
+        std::atomic<double> m_sum{0.0};
+    };
+
+/// Owns every runtime metric and renders them in the Prometheus text format.
+/// Registration takes a lock and is meant for startup or first sight of a
+/// module; updating a metric is a relaxed atomic operation.
+    class MetricsRegistry {
+
+    public:
+        Counter &AddCounter(const std::string &name, const std::string &help, const MetricLabels &labels = {});
+
+        Gauge &AddGauge(const std::string &name, const std::string &help, const MetricLabels &labels = {});
+
+        /// Gauge whose value is read when the metrics are rendered.
+        void AddGauge(const std::string &name, const std::string &help, const MetricLabels &labels,
+                      std::function<double()> read);
+
+        Histogram &AddHistogram(const std::string &name, const std::string &help, const MetricLabels &labels,
+                                std::vector<double> bounds);
+
+        /// Unregisters the series backed by `counter` and frees it. Nothing may update it afterwards.
+        void Remove(const Counter &counter);
+
+        /// Resident memory, open descriptors and heap in use, where the platform reports them.
+        void AddProcessMetrics();
+
+        void WritePrometheus(std::ostream &os) const;
+
+        /// Writes to a temporary file and renames it over the target, so scrapers never see a partial file.
+        bool WriteFile(const std::string &fileName) const;
+
+    private:
+        enum class Type {
+            Counter, Gauge, Histogram
+        };
+
+        struct Series {
+            std::string labels;
+            const Counter *counter = nullptr;
+            const Gauge *gauge = nullptr;
+            const Histogram *histogram = nullptr;
+            std::function<double()> read;
+        };
+
+        struct Family {
+            std::string name;
+            std::string help;
+            Type type;
+            std::vector<Series> series;
+        };
+
+        Series &AddSeries(const std::string &name, const std::string &help, Type type, const MetricLabels &labels);
+
+        mutable std::mutex m_mutex;
+        /// Held while rendering, so Remove() cannot free a counter that is being read.
+        mutable std::mutex m_renderMutex;
+        std::vector<Family> m_families;
+        std::map<std::string, std::size_t> m_index;
+        /// A list, so removing one counter leaves the others where series point at them.
+        std::list<Counter> m_counters;
+        std::deque<Gauge> m_gauges;
+        std::deque<Histogram> m_histograms;
+    };
+
+/// Periodically rewrites a Prometheus text file (node_exporter textfile collector style).
+    class MetricsExporter {
+
+    public:
+        explicit MetricsExporter(const MetricsRegistry &registry) : m_registry(registry) {}
+
+        ~MetricsExporter();
+
+        void Start(const std::string &fileName, std::chrono::milliseconds interval);
+
+        void Stop();
+
+    private:
+        void Run();
+
+        const MetricsRegistry &m_registry;
+        std::string m_fileName;
+        std::chrono::milliseconds m_interval{5000};
+
+        std::mutex m_mutex;
+        std::condition_variable m_cv;
+        bool m_running = false;
+        std::thread m_thread;
+    };
+
+} // namespace AMM
@@ -1,534 +1,612 @@
-#include "ModuleManager.h"
-
-using namespace std;
-using namespace std::chrono;
-using namespace sqlite;
-
-namespace AMM {
-    ModuleManager::ModuleManager() {
-
-        // Initialize everything we'll need to listen for
-        m_mgr->InitializeSimulationControl();
-        m_mgr->InitializeAssessment();
-        m_mgr->InitializeLog();
-        m_mgr->InitializeRenderModification();
-        m_mgr->InitializePhysiologyModification();
-        m_mgr->InitializeEventRecord();
-        m_mgr->InitializeEventFragment();
-        m_mgr->InitializeCommand();
-        m_mgr->InitializeFragmentAmendmentRequest();
-        m_mgr->InitializeOmittedEvent();
-        m_mgr->InitializeOperationalDescription();
-        m_mgr->InitializeModuleConfiguration();
-        m_mgr->InitializeStatus();
-
-        // Module Manager listens to almost everything
-        m_mgr->CreateSimulationControlSubscriber(this, &ModuleManager::onNewSimulationControl);
-        m_mgr->CreateAssessmentSubscriber(this, &ModuleManager::onNewAssessment);
-        m_mgr->CreateLogSubscriber(this, &ModuleManager::onNewLog);
-        m_mgr->CreateRenderModificationSubscriber(this, &ModuleManager::onNewRenderModification);
-        m_mgr->CreatePhysiologyModificationSubscriber(this, &ModuleManager::onNewPhysiologyModification);
-        m_mgr->CreateEventRecordSubscriber(this, &ModuleManager::onNewEventRecord);
-        m_mgr->CreateEventFragmentSubscriber(this, &ModuleManager::onNewEventFragment);
-        m_mgr->CreateCommandSubscriber(this, &ModuleManager::onNewCommand);
-        m_mgr->CreateFragmentAmendmentRequestSubscriber(this, &ModuleManager::onNewFragmentAmendmentRequest);
-        m_mgr->CreateOmittedEventSubscriber(this, &ModuleManager::onNewOmittedEvent);
-        m_mgr->CreateOperationalDescriptionSubscriber(this, &ModuleManager::onNewOperationalDescription);
-        m_mgr->CreateModuleConfigurationSubscriber(this, &ModuleManager::onNewModuleConfiguration);
-        m_mgr->CreateStatusSubscriber(this, &ModuleManager::onNewStatus);
-
-        // We only publish module configuration and sim controls
-        m_mgr->CreateOperationalDescriptionPublisher();
-        m_mgr->CreateModuleConfigurationPublisher();
-        m_mgr->CreateSimulationControlPublisher();
-        m_mgr->CreateCommandPublisher();
-
-        m_uuid.id(m_mgr->GenerateUuidString());
-    }
-
-    ModuleManager::~ModuleManager() {
-        m_mgr->Shutdown();
-    }
-
-    void ModuleManager::PublishOperationalDescription() {
-        AMM::OperationalDescription od;
-        od.name(moduleName);
-        od.model("Module Manager");
-        od.manufacturer("Vcom3D");
-        od.serial_number("1.0.0");
-        od.module_id(m_uuid);
-        od.module_version("1.0.0");
-        const std::string capabilities = Utility::read_file_to_string("config/module_manager_capabilities.xml");
-        od.capabilities_schema(capabilities);
-        od.description();
-        m_mgr->WriteOperationalDescription(od);
-    }
-
-    void ModuleManager::PublishConfiguration() {
-        AMM::ModuleConfiguration mc;
-        auto ms = duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
-        mc.timestamp(ms);
-        mc.module_id(m_uuid);
-        mc.name(moduleName);
-        const std::string configuration = Utility::read_file_to_string("config/module_manager_configuration.xml");
-        mc.capabilities_configuration(configuration);
-        m_mgr->WriteModuleConfiguration(mc);
-    }
-
-    void ModuleManager::Shutdown() {
-        /// Gracefully close and delete everything created by mod manager.
-
-    }
-
-    void ModuleManager::ShowStatus() {
-        // Show connected modules
-    }
-
-    void ModuleManager::ClearEventLog() {}
-
-    void ModuleManager::ClearDiagnosticLog() {}
-
-    uint64_t ModuleManager::GetTimestamp() {
-        return std::chrono::duration_cast<std::chrono::seconds>(
-                std::chrono::system_clock::now().time_since_epoch()).count();
-    }
-
-    std::string ModuleManager::ExtractGUIDToString(GUID_t guid) {
-        std::ostringstream module_guid;
-        module_guid << guid;
-        return module_guid.str().substr(0, module_guid.str().find("|"));
-    }
-
-    void ModuleManager::onNewLog(AMM::Log &log, SampleInfo_t *info) {
-        LOG_TRACE << "Log recieved:\n"
-                  << "Timestamp: " << log.timestamp() << "\n"
-                  << "Module ID: " << log.module_id().id() << "\n"
-                  << "Level:     " << AMM::Utility::ELogLevelStr(log.level()) << "\n"
-                  << "Message:   " << log.message();
-
-        std::string module_guid = ExtractGUIDToString(info->sample_identity.writer_guid());
-
-        sqlite_config config;
-        database db("amm.db", config);
-        m_mapmutex.lock();
-        try {
-            db
-                    << "insert into logs (module_id, module_guid, message, log_level, timestamp) values (?,?,?,?,?);"
-                    << log.module_id().id()
-                    << module_guid
-                    << log.message()
-                    << AMM::Utility::ELogLevelStr(log.level())
-                    << log.timestamp();
-        } catch (exception &e) {
-            LOG_ERROR << e.what();
-        }
-        m_mapmutex.unlock();
-    }
-
-
-    void ModuleManager::onNewModuleConfiguration(AMM::ModuleConfiguration &mc, SampleInfo_t *info) {
-        LOG_TRACE << "Module Configuration recieved:\n"
-                  << "Name:         " << mc.name() << "\n"
-                  << "Module ID:    " << mc.module_id().id() << "\n"
-                  << "Encounter:    " << mc.educational_encounter().id() << "\n"
-                  << "Timestamp:    " << mc.timestamp() << "\n"
-                  << "Capabilities: Not shown";
-
-        std::string module_guid = ExtractGUIDToString(info->sample_identity.writer_guid());
-
-        m_mapmutex.lock();
-        try {
-
-        } catch (exception &e) {
-            LOG_ERROR << e.what();
-        }
-
-        m_mapmutex.unlock();
-    }
-
-
-    void ModuleManager::onNewStatus(AMM::Status &status, SampleInfo_t *info) {
-        LOG_TRACE << "Status recieved:\n"
-                  << "Module ID:   " << status.module_id().id() << "\n"
-                  << "Module Name: " << status.module_name() << "\n"
-                  << "Encounter:   " << status.educational_encounter().id() << "\n"
-                  << "Capability:  " << status.capability() << "\n"
-                  << "Timestamp:   " << status.timestamp() << "\n"
-                  << "Value:       " << AMM::Utility::EStatusValueStr(status.value()) << "\n"
-                  << "Message:     " << status.message();
-
-        sqlite_config config;
-        database db("amm.db", config);
-
-        std::string module_guid = ExtractGUIDToString(info->sample_identity.writer_guid());
-
-        m_mapmutex.lock();
-        try {
-            db << "replace into module_status (module_id, module_guid, module_name, "
-                  "capability, status, message, timestamp, encounter_id) values (?,?,?,?,?,?,?,?);"
-               << status.module_id().id() << module_guid << status.module_name()
-               << status.capability() << AMM::Utility::EStatusValueStr(status.value())
-               << status.message()
-               << status.timestamp() << status.educational_encounter().id();
-
-        } catch (exception &e) {
-            LOG_ERROR << e.what();
-        }
-        m_mapmutex.unlock();
-    }
-
-    void ModuleManager::onNewSimulationControl(AMM::SimulationControl &simControl, SampleInfo_t *info) {
-        LOG_TRACE << "Simulation Control recieved:\n"
-                  << "Timestamp: " << simControl.timestamp() << "\n"
-                  << "Type:      " << AMM::Utility::EControlTypeStr(simControl.type()) << "\n"
-                  << "Encounter: " << simControl.educational_encounter().id();
-
-        switch (simControl.type()) {
-            case AMM::ControlType::RUN: {
-
-                break;
-            }
-
-            case AMM::ControlType::HALT: {
-
-                break;
-            }
-
-            case AMM::ControlType::RESET: {
-
-                break;
-            }
-
-            case AMM::ControlType::SAVE: {
-
-                break;
-            }
-        }
-
-        std::string module_guid = ExtractGUIDToString(info->sample_identity.writer_guid());
-        std::ostringstream logmessage;
-        logmessage << "[" << AMM::Utility::EControlTypeStr(simControl.type()) << "]";
-        LogEntry newLogEntry{module_guid, AMM::TopicNames::SimControl, "n/a", simControl.timestamp(),
-                             logmessage.str()};
-        WriteLogEntry(newLogEntry);
-    }
-
-    void ModuleManager::onNewAssessment(AMM::Assessment &assessment, SampleInfo_t *info) {
-        LOG_TRACE << "Assessment recieved:\n"
-                  << "ID:       " << assessment.id().id() << "\n"
-                  << "Event ID: " << assessment.event_id().id() << "\n"
-                  << "Value:    " << AMM::Utility::EAssessmentValueStr(assessment.value()) << "\n"
-                  << "Comment:  " << assessment.comment();
-
-        uint64_t timestamp = GetTimestamp();
-        std::string module_guid = ExtractGUIDToString(info->sample_identity.writer_guid());
-
-        std::ostringstream logmessage;
-        logmessage << "[" << assessment.value() << "]" << assessment.comment();
-        LogEntry newLogEntry{module_guid, AMM::TopicNames::Assessment, assessment.event_id().id(), timestamp,
-                             logmessage.str()};
-        WriteLogEntry(newLogEntry);
-    }
-
-    void ModuleManager::onNewEventFragment(AMM::EventFragment &ef, SampleInfo_t *info) {
-        LOG_TRACE << "Event Fragment recieved:\n"
-                  << "ID:        " << ef.id().id() << "\n"
-                  << "Timestamp: " << ef.timestamp() << "\n"
-                  << "Encounter: " << ef.educational_encounter().id() << "\n"
-                  << "Location:  " << ef.location().name() << " - " << ef.location().FMAID() << "\n"
-                  << "Agent:     " << AMM::Utility::EEventAgentTypeStr(ef.agent_type()) << "\n"
-                  << "Agent ID:  " << ef.agent_id().id() << "\n"
-                  << "Type:      " << ef.type() << "\n"
-                  << "Data:      " << ef.data();
-
-        std::string module_guid = ExtractGUIDToString(info->sample_identity.writer_guid());
-
-        std::ostringstream logmessage;
-        logmessage << "[" << ef.type() << "]" << ef.data();
-        LogEntry newLogEntry{module_guid, AMM::TopicNames::EventFragment, ef.id().id(), ef.timestamp(),
-                             logmessage.str()};
-        WriteLogEntry(newLogEntry);
-    }
-
-    void ModuleManager::onNewEventRecord(AMM::EventRecord &er, SampleInfo_t *info) {
-        LOG_TRACE << "Event Record recieved:\n"
-                  << "ID:        " << er.id().id() << "\n"
-                  << "timestamp: " << er.timestamp() << "\n"
-                  << "Encounter: " << er.educational_encounter().id() << "\n"
-                  << "Location:  " << er.location().name() << " - " << er.location().FMAID() << "\n"
-                  << "Agent:     " << AMM::Utility::EEventAgentTypeStr(er.agent_type()) << "\n"
-                  << "Agent ID:  " << er.agent_id().id() << "\n"
-                  << "Type:      " << er.type() << "\n"
-                  << "Data:      " << er.data();
-
-        std::string module_guid = ExtractGUIDToString(info->sample_identity.writer_guid());
-
-        std::ostringstream logmessage;
-        logmessage << "[" << er.type() << "]" << er.data();
-        LogEntry newLogEntry{module_guid, AMM::TopicNames::EventRecord, er.id().id(), er.timestamp(),
-                             logmessage.str()};
-        WriteLogEntry(newLogEntry);
-    }
-
-    void ModuleManager::onNewFragmentAmendmentRequest(AMM::FragmentAmendmentRequest &ffar, SampleInfo_t *info) {
-        LOG_TRACE << "Fragment Amendment Request recieved:\n"
-                  << "ID:          " << ffar.id().id() << "\n"
-                  << "Fragment ID: " << ffar.fragment_id().id() << "\n"
-                  << "Status:      " << AMM::Utility::EFarStatusStr(ffar.status()) << "\n"
-                  << "Location:    " << ffar.location().name() << " - " << ffar.location().FMAID() << "\n"
-                  << "Agent:       " << AMM::Utility::EEventAgentTypeStr(ffar.agent_type()) << "\n"
-                  << "Agent ID:    " << ffar.agent_id().id();
-
-        uint64_t timestamp = GetTimestamp();
-        std::string module_guid = ExtractGUIDToString(info->sample_identity.writer_guid());
-
-        std::ostringstream logmessage;
-        logmessage << "[" << ffar.fragment_id().id() << "]" << ffar.status();
-        LogEntry newLogEntry{module_guid, AMM::TopicNames::FragmentAmendmentRequest, ffar.id().id(), timestamp,
-                             logmessage.str()};
-        WriteLogEntry(newLogEntry);
-    }
-
-    void ModuleManager::onNewOmittedEvent(AMM::OmittedEvent &omittedEvent, SampleInfo_t *info) {
-        LOG_TRACE << "\nOmitted Event recieved:\n"
-                  << "ID:        " << omittedEvent.id().id() << "\n"
-                  << "timestamp: " << omittedEvent.timestamp() << "\n"
-                  << "Encounter: " << omittedEvent.educational_encounter().id() << "\n"
-                  << "Location:  " << omittedEvent.location().name() << " - " << omittedEvent.location().FMAID() << "\n"
-                  << "Agent:     " << AMM::Utility::EEventAgentTypeStr(omittedEvent.agent_type()) << "\n"
-                  << "Agent ID:  " << omittedEvent.agent_id().id() << "\n"
-                  << "Type:      " << omittedEvent.type() << "\n"
-                  << "Data:      " << omittedEvent.data();
-
-        std::string module_guid = ExtractGUIDToString(info->sample_identity.writer_guid());
-
-        std::ostringstream logmessage;
-        logmessage << "[" << omittedEvent.type() << "]" << omittedEvent.data();
-        LogEntry newLogEntry{module_guid, AMM::TopicNames::OmittedEvent, omittedEvent.id().id(),
-                             omittedEvent.timestamp(),
-                             logmessage.str()};
-        WriteLogEntry(newLogEntry);
-    }
-
-    void ModuleManager::onNewOperationalDescription(AMM::OperationalDescription &opDescript, SampleInfo_t *info) {
-        LOG_INFO << "Operational description for module " << opDescript.name() << " / model " << opDescript.model();
-
-        sqlite_config config;
-        database db("amm.db", config);
-
-        std::string module_guid = ExtractGUIDToString(info->sample_identity.writer_guid());
-
-        m_mapmutex.lock();
-        if (opDescript.name() == "disconnect") {
-            try {
-                db << "delete from module_capabilities where module_id = ? ;" << module_guid;
-            } catch (exception &e) {
-                LOG_ERROR << e.what();
-            }
-        } else {
-            try {
-                db << "replace into module_capabilities (module_id, module_guid,"
-                      "module_name, description, "
-                      "manufacturer, model,"
-                      "module_version, serial_number,"
-                      "capabilities) values (?,?,?,?,?,?,?,?,?);"
-                   << opDescript.module_id().id() << module_guid
-                   << opDescript.name() << opDescript.description()
-                   << opDescript.manufacturer() << opDescript.model()
-                   << opDescript.module_version() << opDescript.serial_number()
-                   << opDescript.capabilities_schema().to_string();
-            } catch (exception &e) {
-                LOG_ERROR << e.what();
-            }
-        }
-        m_mapmutex.unlock();
-
-    }
-
-    void ModuleManager::onNewRenderModification(AMM::RenderModification &rendMod, SampleInfo_t *info) {
-        if (rendMod.data().to_string().find("START_OF") == std::string::npos) {
-            LOG_TRACE << "Render Modification recieved:\n"
-                      << "ID:       " << rendMod.id().id() << "\n"
-                      << "Event ID: " << rendMod.event_id().id() << "\n"
-                      << "Type:     " << rendMod.type() << "\n"
-                      << "Data      " << rendMod.data();
-        } else {
-            // inhale/exhale message
-            return;
-        }
-
-        uint64_t timestamp = GetTimestamp();
-        std::string module_guid = ExtractGUIDToString(info->sample_identity.writer_guid());
-
-        std::ostringstream logmessage;
-        logmessage << "[" << rendMod.type() << "]" << rendMod.data();
-        LogEntry newLogEntry{module_guid, AMM::TopicNames::RenderModification, rendMod.event_id().id(), timestamp,
-                             logmessage.str()};
-        WriteLogEntry(newLogEntry);
-    }
-
-    void ModuleManager::onNewPhysiologyModification(AMM::PhysiologyModification &physMod, SampleInfo_t *info) {
-        LOG_TRACE << "Physiology Modification recieved:\n"
-                  << "ID:       " << physMod.id().id() << "\n"
-                  << "Event ID: " << physMod.event_id().id() << "\n"
-                  << "Type:     " << physMod.type() << "\n"
-                  << "Data:     " << physMod.data();
-
-        uint64_t timestamp = GetTimestamp();
-        std::string module_guid = ExtractGUIDToString(info->sample_identity.writer_guid());
-
-        std::ostringstream logmessage;
-        logmessage << "[" << physMod.type() << "]" << physMod.data();
-        LogEntry newLogEntry{module_guid, AMM::TopicNames::PhysiologyModification, physMod.event_id().id(), timestamp,
-                             logmessage.str()};
-        WriteLogEntry(newLogEntry);
-    }
-
-    void ModuleManager::SendTestCommand(const std::string action) {
-        AMM::Command cmdInstance;
-        cmdInstance.message(action);
-        m_mgr->WriteCommand(cmdInstance);
-    }
-
-    void ModuleManager::onNewCommand(AMM::Command &command, eprosima::fastrtps::SampleInfo_t *info) {
-        LOG_TRACE << "Command recieved:\n"
-                  << "Message:" << command.message();
-
-        uint64_t timestamp = GetTimestamp();
-        std::string module_guid = ExtractGUIDToString(info->sample_identity.writer_guid());
-
-        LogEntry newLogEntry{module_guid, AMM::TopicNames::Command, "n/a", timestamp,
-                             command.message()};
-        WriteLogEntry(newLogEntry);
-
-        std::ostringstream messageOut;
-
-        if (!command.message().compare(0, sysPrefix.size(), sysPrefix)) {
-            std::string value = command.message().substr(sysPrefix.size());
-            if (value.compare("START_SIM") == 0) {
-
-            } else if (value.compare("STOP_SIM") == 0) {
-
-            } else if (value.compare("PAUSE_SIM") == 0) {
-
-            } else if (value.compare("RESET_SIM") == 0) {
-
-            } else if (!value.compare(0, loadScenarioPrefix.size(), loadScenarioPrefix)) {
-                currentScenario = value.substr(loadScenarioPrefix.size());
-                LOG_INFO << "Load scenario command received for " << currentScenario;
-
-                LOG_INFO << "Sending simcontrol RESET";
-                AMM::SimulationControl simControl;
-                auto ms = duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
-                simControl.timestamp(ms);
-                simControl.type(AMM::ControlType::RESET);
-                m_mgr->WriteSimulationControl(simControl);
-
-                if (currentScenario.find(";mid=") != std::string::npos) {
-                    std::size_t pos = currentScenario.find(";mid=");
-                    std::string mid = currentScenario.substr(pos + 5);
-                    currentScenario = currentScenario.substr(0, pos);
-                    LOG_INFO << " Scene is " << currentScenario;
-                    LOG_INFO << " Manikin is " << mid;
-                } else {
-                    LOG_INFO << " Scene is " << currentScenario;
-                }
-                ParseScenarioFromFile("static/scenarios/" + currentScenario + ".xml");
-            } else if (!value.compare(0, loadPrefix.size(), loadPrefix)) {
-                currentState = value.substr(loadStatePrefix.size());
-            } else {
-                messageOut << "ACT" << "=" << command.message() << std::endl;
-                LOG_INFO << "Unknown system message: " << messageOut.str();
-            }
-        } else {
-            messageOut << "ACT"
-                       << "=" << command.message() << "|";
-            LOG_INFO << "Unknown message: " << messageOut.str();
-        }
-    }
-
-
-    void ModuleManager::WriteLogEntry(LogEntry newLogEntry) {
-        sqlite_config config;
-        database db("amm.db", config);
-
-        m_mapmutex.lock();
-        try {
-            db << "insert into events (source, topic, event_id, timestamp, data) values (?,?,?,?,?);"
-               << newLogEntry.source << newLogEntry.topic << newLogEntry.event_id
-               << newLogEntry.timestamp << newLogEntry.data;
-        } catch (exception &e) {
-            LOG_ERROR << e.what();
-        }
-        m_mapmutex.unlock();
-    }
-
-    void ModuleManager::ParseScenarioFromFile(const std::string xmlFileName) {
-        LOG_INFO << "Loading " << xmlFileName << " from filesystem.";
-        tinyxml2::XMLDocument doc;
-        doc.LoadFile(xmlFileName.c_str());
-        tinyxml2::XMLNode *pRoot = doc.RootElement();
-        if (pRoot == nullptr) {
-            LOG_ERROR << "Unable to get XML root.";
-            return;
-        }
-        tinyxml2::XMLElement *scenario = pRoot->FirstChildElement();
-
-        LOG_INFO << "Loading scenario: " << scenario->Attribute("name");
-
-        tinyxml2::XMLElement *metadata = scenario->FirstChildElement("metadata");
-
-        if (metadata != nullptr) {
-            LOG_TRACE << "Metadata is present, so let's parse and publish it.";
-            ParseMetadata(metadata);
-        }
-
-        tinyxml2::XMLElement *capability = scenario->FirstChildElement("capabilities")->FirstChildElement("capability");
-
-        if (capability == nullptr) {
-            LOG_ERROR << "Unable to find capabilities";
-            return;
-        }
-
-        ParseCapabilities(capability);
-    }
-
-    void ModuleManager::ParseMetadata(tinyxml2::XMLElement *node) {
-        tinyxml2::XMLPrinter printer;
-        node->Accept(&printer);
-        LOG_INFO << "Sending out metadata";
-        AMM::ModuleConfiguration mc;
-        auto ms = duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
-        mc.timestamp(ms);
-        mc.name("metadata");
-        mc.capabilities_configuration(printer.CStr());
-        m_mgr->WriteModuleConfiguration(mc);
-    }
-
-    void ModuleManager::ParseCapabilities(tinyxml2::XMLElement *node) {
-        while (node) {
-            if (node->Attribute("name") == nullptr) {
-                LOG_INFO << "Capability is not named, we can't process it.";
-                return;
-            }
-            std::string capabilityName = node->Attribute("name");
-            LOG_INFO << "Parsing capability " << node->Attribute("name");
-
-            tinyxml2::XMLElement *config_data = node->FirstChildElement("configuration_data");
-            if (config_data != nullptr) {
-                LOG_INFO << "Capability has configuration, so we'll publish it to the bus.";
-                tinyxml2::XMLPrinter printer;
-                node->Accept(&printer);
-
-                AMM::ModuleConfiguration mc;
-                auto ms = duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
-                mc.timestamp(ms);
-                mc.name(capabilityName);
-                mc.capabilities_configuration(printer.CStr());
-                m_mgr->WriteModuleConfiguration(mc);
-            }
-
-            node = node->NextSiblingElement();
-        }
-    }
-}
+#include "ModuleManager.h"
+
+#include "Schema.h"
+#include "SqlProfiler.h"
+#include "Tracer.h"
+
+#include <future>
+#include <iomanip>
+
+using namespace std;
+using namespace std::chrono;
+using namespace sqlite;
+
+namespace AMM {
+    ModuleManager::ModuleManager() {
+        MarkStartupPhase("participant");
+        RegisterMetrics();
+
+        // The database work touches nothing on the bus, so it overlaps topic and publisher creation.
+        std::future<int64_t> database = std::async(std::launch::async, [this] {
+            Tracer::SetThreadName("startup-db");
+            TraceSpan span("database", "startup");
+            const int64_t start = Clock::NowNs();
+            SqlProfiler::Attach(m_db.connection().get());
+            sqlite3_busy_timeout(m_db.connection().get(), BusyTimeoutMs);
+            UpgradeSchema(m_db.connection().get());
+            LoadModuleRegistry();
+            m_logWriter.Start();
+            // Parsing the scenario library here keeps it off the first LOAD_SCENARIO.
+            m_scenarios.Preload();
+            m_scenarios.Watch();
+            return Clock::NowNs() - start;
+        });
+
+        {
+            // Endpoint creation stays serial: DDSManager keeps its endpoints in unsynchronized
+            // members, and Fast RTPS takes the participant lock for each one anyway.
+            TraceSpan span("topics", "startup");
+            m_mgr->InitializeSimulationControl();
+            m_mgr->InitializeAssessment();
+            m_mgr->InitializeLog();
+            m_mgr->InitializeRenderModification();
+            m_mgr->InitializePhysiologyModification();
+            m_mgr->InitializeEventRecord();
+            m_mgr->InitializeEventFragment();
+            m_mgr->InitializeCommand();
+            m_mgr->InitializeFragmentAmendmentRequest();
+            m_mgr->InitializeOmittedEvent();
+            m_mgr->InitializeOperationalDescription();
+            m_mgr->InitializeModuleConfiguration();
+            m_mgr->InitializeStatus();
+        }
+        MarkStartupPhase("topics");
+
+        {
+            // We only publish module configuration and sim controls. Publishers go first so
+            // remote readers are matching while the subscribers are created.
+            TraceSpan span("publishers", "startup");
+            m_mgr->CreateOperationalDescriptionPublisher();
+            m_mgr->CreateModuleConfigurationPublisher();
+            m_mgr->CreateSimulationControlPublisher();
+            m_mgr->CreateCommandPublisher();
+            m_mgr->CreateStatusPublisher();
+        }
+        MarkStartupPhase("publishers");
+
+        // Samples must not be resolved before the registry knows the last module key.
+        const int64_t databaseNs = database.get();
+        MarkStartupPhase("database wait");
+        m_startupPhases.emplace_back("database (overlapped)", databaseNs);
+
+        {
+            // Module Manager listens to almost everything
+            TraceSpan span("subscribers", "startup");
+            m_mgr->CreateSimulationControlSubscriber(this, &ModuleManager::onNewSample<AMM::SimulationControl>);
+            m_mgr->CreateAssessmentSubscriber(this, &ModuleManager::onNewSample<AMM::Assessment>);
+            m_mgr->CreateLogSubscriber(this, &ModuleManager::onNewSample<AMM::Log>);
+            m_mgr->CreateRenderModificationSubscriber(this, &ModuleManager::onNewSample<AMM::RenderModification>);
+            m_mgr->CreatePhysiologyModificationSubscriber(this,
+                                                          &ModuleManager::onNewSample<AMM::PhysiologyModification>);
+            m_mgr->CreateEventRecordSubscriber(this, &ModuleManager::onNewSample<AMM::EventRecord>);
+            m_mgr->CreateEventFragmentSubscriber(this, &ModuleManager::onNewSample<AMM::EventFragment>);
+            m_mgr->CreateCommandSubscriber(this, &ModuleManager::onNewSample<AMM::Command>);
+            m_mgr->CreateFragmentAmendmentRequestSubscriber(this,
+                                                            &ModuleManager::onNewSample<AMM::FragmentAmendmentRequest>);
+            m_mgr->CreateOmittedEventSubscriber(this, &ModuleManager::onNewSample<AMM::OmittedEvent>);
+            m_mgr->CreateOperationalDescriptionSubscriber(this,
+                                                          &ModuleManager::onNewSample<AMM::OperationalDescription>);
+            m_mgr->CreateModuleConfigurationSubscriber(this, &ModuleManager::onNewSample<AMM::ModuleConfiguration>);
+            m_mgr->CreateStatusSubscriber(this, &ModuleManager::onNewSample<AMM::Status>);
+        }
+        MarkStartupPhase("subscribers");
+
+        m_uuid.id(m_mgr->GenerateUuidString());
+        m_watchdog.Start();
+        m_scenarioLoader.Start();
+    }
+
+    ModuleManager::~ModuleManager() {
+        Shutdown();
+        delete m_mgr;
+    }
+
+    void ModuleManager::RegisterMetrics() {
+        for (std::size_t i = 0; i < TopicCount; ++i) {
+            const MetricLabels labels{{"topic", TopicName(static_cast<TopicId>(i))}};
+            m_samplesReceived[i] = &m_metrics.AddCounter("amm_samples_received_total",
+                                                         "Samples delivered to the manager's listeners.", labels);
+            m_bytesReceived[i] = &m_metrics.AddCounter("amm_bytes_received_total",
+                                                       "Serialized size of the samples received.", labels);
+        }
+
+        m_metrics.AddProcessMetrics();
+        m_metrics.AddGauge("amm_modules_known", "Participants the manager has received samples from.", {},
+                           [this] { return static_cast<double>(m_registry.Size()); });
+
+        m_registry.SetInitializer([this](ModuleRecord &record) {
+            const MetricLabels labels{{"module_guid", record.guid}, {"module_key", std::to_string(record.key)}};
+            record.samples = &m_metrics.AddCounter("amm_module_samples_received_total",
+                                                   "Samples received from one module.", labels);
+            record.bytes = &m_metrics.AddCounter("amm_module_bytes_received_total",
+                                                 "Serialized size of the samples received from one module.", labels);
+        });
+        m_registry.SetFinalizer([this](ModuleRecord &record) {
+            m_metrics.Remove(*record.samples);
+            m_metrics.Remove(*record.bytes);
+            m_statusBoard.Forget(record.key);
+        });
+    }
+
+    void ModuleManager::StartMetricsExport(const std::string &fileName, std::chrono::milliseconds interval) {
+        m_metricsExporter.Start(fileName, interval);
+    }
+
+    void ModuleManager::PublishOperationalDescription() {
+        AMM::OperationalDescription od;
+        od.name(moduleName);
+        od.model("Module Manager");
+        od.manufacturer("Vcom3D");
+        od.serial_number("1.0.0");
+        od.module_id(m_uuid);
+        od.module_version("1.0.0");
+        const std::string capabilities = Utility::read_file_to_string("config/module_manager_capabilities.xml");
+        od.capabilities_schema(capabilities);
+        od.description();
+        m_mgr->WriteOperationalDescription(od);
+    }
+
+    void ModuleManager::PublishConfiguration() {
+        AMM::ModuleConfiguration mc;
+        auto ms = duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+        mc.timestamp(ms);
+        mc.module_id(m_uuid);
+        mc.name(moduleName);
+        const std::string configuration = Utility::read_file_to_string("config/module_manager_configuration.xml");
+        mc.capabilities_configuration(configuration);
+        WriteModuleConfiguration(mc);
+    }
+
+    void ModuleManager::OnNewPeer(std::function<void()> callback) {
+        std::lock_guard<std::mutex> lock(m_startupMutex);
+        m_onNewPeer = std::move(callback);
+    }
+
+    void ModuleManager::MarkStartupPhase(const std::string &phase) {
+        std::lock_guard<std::mutex> lock(m_startupMutex);
+        const int64_t now = Clock::NowNs();
+        m_startupPhases.emplace_back(phase, now - m_startupMark);
+        m_startupMark = now;
+    }
+
+    void ModuleManager::ReportStartup() {
+        std::ostringstream report;
+        std::lock_guard<std::mutex> lock(m_startupMutex);
+        int64_t total = 0;
+        for (const auto &phase : m_startupPhases) {
+            report << "\n  " << std::left << std::setw(24) << phase.first << std::right << std::fixed
+                   << std::setprecision(1) << std::setw(8) << static_cast<double>(phase.second) / 1e6 << " ms";
+            if (phase.first.find("overlapped") == std::string::npos) {
+                total += phase.second;
+            }
+        }
+        LOG_INFO << "Startup took " << std::fixed << std::setprecision(1) << static_cast<double>(total) / 1e6
+                 << " ms:" << report.str();
+    }
+
+    void ModuleManager::Shutdown(std::chrono::milliseconds deadline) {
+        if (m_shutDown.exchange(true)) {
+            return;
+        }
+        TraceSpan span("Shutdown", "shutdown");
+        const int64_t start = Clock::NowNs();
+        const uint64_t committedBefore = m_logWriter.Committed();
+        const uint64_t droppedBefore = m_logWriter.Dropped() + m_logWriter.Failed();
+        const std::size_t queued = m_logWriter.Pending();
+        LOG_INFO << "Shutting down: " << queued << " events queued, draining for up to " << deadline.count()
+                 << " ms.";
+
+        // Stop ingest first. Tearing down the endpoints waits out callbacks already running,
+        // so nothing reaches the queues once it returns.
+        m_accepting = false;
+        // The loader publishes, so it stops before the endpoints go.
+        m_scenarioLoader.Stop();
+        m_mgr->Shutdown();
+        m_capture.Stop();
+
+        const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::nanoseconds(Clock::NowNs() - start));
+        const bool drained = m_logWriter.Drain(std::max(deadline - elapsed, std::chrono::milliseconds(0)));
+        m_watchdog.Stop();
+        m_scenarios.StopWatching();
+
+        {
+            std::lock_guard<std::mutex> lock(m_mapmutex);
+            for (auto &statement : m_statements) {
+                if (statement) {
+                    statement->used(true);
+                    statement.reset();
+                }
+            }
+            try {
+                std::string journalMode;
+                m_db << "pragma journal_mode;" >> journalMode;
+                if (journalMode == "wal") {
+                    m_db << "pragma wal_checkpoint(truncate);";
+                }
+            } catch (exception &e) {
+                LOG_ERROR << e.what();
+            }
+        }
+
+        // Last, so the exported file carries the final counts.
+        m_metricsExporter.Stop();
+
+        LOG_INFO << "Shutdown " << (drained ? "complete" : "incomplete") << " after "
+                 << (Clock::NowNs() - start) / 1000000 << " ms: " << m_logWriter.Committed() - committedBefore
+                 << " events flushed, " << m_logWriter.Dropped() + m_logWriter.Failed() - droppedBefore
+                 << " dropped, " << m_rejected.load() << " samples ignored after close.";
+    }
+
+    std::shared_ptr<const StatusSnapshot> ModuleManager::RefreshStatus() {
+        std::shared_ptr<StatusSnapshot> snapshot = std::make_shared<StatusSnapshot>();
+        snapshot->taken = Clock::NowNs();
+        snapshot->wallTime = Clock::WallNs();
+
+        snapshot->topics.resize(TopicCount);
+        for (std::size_t i = 0; i < TopicCount; ++i) {
+            snapshot->topics[i].name = TopicName(static_cast<TopicId>(i));
+            snapshot->topics[i].samples = m_samplesReceived[i]->Value();
+        }
+
+        m_registry.ForEach([&snapshot](const ModuleRecord &record) {
+            StatusSnapshot::Module module;
+            module.key = record.key;
+            module.guid = record.guid;
+            module.module_id = record.module_id;
+            module.name = record.name;
+            module.samples = record.samples != nullptr ? record.samples->Value() : 0;
+            snapshot->modules.push_back(std::move(module));
+        });
+
+        snapshot->eventQueue = m_logWriter.Pending();
+        snapshot->eventQueueCapacity = m_logWriter.Capacity();
+        snapshot->eventsCommitted = m_logWriter.Committed();
+        snapshot->eventsDropped = m_logWriter.Dropped() + m_logWriter.Failed();
+        snapshot->capturing = m_capture.Active();
+        snapshot->captureRecords = m_capture.Records();
+
+        return m_statusBoard.Publish(snapshot);
+    }
+
+    void ModuleManager::ShowStatus() {
+        std::cout << std::endl;
+        PrintStatus(*RefreshStatus(), std::cout);
+
+        std::ostringstream latency;
+        m_latency.PrintSummary(latency);
+        std::cout << std::endl << "Ingest latency:" << std::endl << latency.str();
+
+        std::ostringstream slowest;
+        m_watchdog.PrintSlowest(slowest);
+        std::cout << std::endl << "Slowest listener callbacks:" << std::endl << slowest.str();
+    }
+
+    bool ModuleManager::StartRecording(const std::string &fileName) {
+        return m_capture.Start(fileName);
+    }
+
+    void ModuleManager::StopRecording() {
+        m_capture.Stop();
+    }
+
+    void ModuleManager::SetListenerBudget(std::chrono::milliseconds budget) {
+        m_watchdog.SetBudget(budget);
+        LOG_INFO << "Listener budget set to " << budget.count() << " ms";
+    }
+
+    bool ModuleManager::DumpLatency(const std::string &fileName) {
+        if (!m_latency.Dump(fileName)) {
+            LOG_ERROR << "Unable to write latency histograms to " << fileName;
+            return false;
+        }
+        LOG_INFO << "Latency histograms written to " << fileName;
+        return true;
+    }
+
+    void ModuleManager::ClearEventLog() {}
+
+    void ModuleManager::ClearDiagnosticLog() {}
+
+    uint64_t ModuleManager::GetTimestamp() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    uint64_t ModuleManager::SourceTimestamp(const SampleTimes &times) {
+        return times.source > 0 ? Clock::ToMs(times.source) : GetTimestamp();
+    }
+
+    const ModuleRecord &ModuleManager::ResolveModule(SampleInfo_t *info) {
+        bool created = false;
+        const ModuleRecord &module = m_registry.Resolve(info->sample_identity.writer_guid(), &created);
+        if (created) {
+            StoreModule(module);
+            std::function<void()> callback;
+            {
+                std::lock_guard<std::mutex> lock(m_startupMutex);
+                callback = m_onNewPeer;
+            }
+            if (callback) {
+                callback();
+            }
+        }
+        return module;
+    }
+
+    void ModuleManager::LoadModuleRegistry() {
+        std::lock_guard<std::mutex> lock(m_mapmutex);
+        try {
+            int lastKey = 0;
+            m_db << "select ifnull(max(module_key), 0) from modules;" >> lastKey;
+            m_registry.SetLastKey(static_cast<uint32_t>(lastKey));
+        } catch (exception &e) {
+            LOG_ERROR << e.what();
+        }
+    }
+
+    void ModuleManager::StoreModule(const ModuleRecord &module) {
+        std::lock_guard<std::mutex> lock(m_mapmutex);
+        try {
+            m_db << "replace into modules (module_key, module_guid, module_id, module_name) values (?,?,?,?);"
+               << static_cast<int>(module.key) << module.guid << module.module_id << module.name;
+        } catch (exception &e) {
+            LOG_ERROR << e.what();
+        }
+    }
+
+    bool ModuleManager::SetupTables(std::string *error) {
+        {
+            std::lock_guard<std::mutex> lock(m_mapmutex);
+            if (!CreateTables(m_db.connection().get(), error)) {
+                return false;
+            }
+        }
+        return WipeTables(error);
+    }
+
+    bool ModuleManager::WipeTables(std::string *error) {
+        {
+            // The log writer commits under this mutex too, so no write transaction of ours is open.
+            std::lock_guard<std::mutex> lock(m_mapmutex);
+            TraceSpan span("WipeTables", "db");
+            if (!AMM::WipeTables(m_db.connection().get(), error)) {
+                return false;
+            }
+        }
+        StoreModules();
+        return true;
+    }
+
+    void ModuleManager::StoreModules() {
+        std::vector<ModuleRecord> records;
+        m_registry.ForEach([&records](const ModuleRecord &record) { records.push_back(record); });
+        for (const ModuleRecord &record : records) {
+            StoreModule(record);
+        }
+    }
+
+    void ModuleManager::EvictIdleModules() {
+        const std::size_t evicted = m_registry.EvictIdle();
+        if (evicted > 0) {
+            LOG_INFO << "Forgot " << evicted << " idle module" << (evicted == 1 ? "" : "s") << ", "
+                     << m_registry.Size() << " still known.";
+        }
+    }
+
+    void ModuleManager::Process(AMM::SimulationControl &simControl, const ModuleRecord &module,
+                                const SampleTimes &times) {
+        switch (simControl.type()) {
+            case AMM::ControlType::RUN: {
+
+                break;
+            }
+
+            case AMM::ControlType::HALT: {
+
+                break;
+            }
+
+            case AMM::ControlType::RESET: {
+
+                break;
+            }
+
+            case AMM::ControlType::SAVE: {
+
+                break;
+            }
+        }
+    }
+
+    void ModuleManager::Process(AMM::OperationalDescription &opDescript, const ModuleRecord &module,
+                                const SampleTimes &times) {
+        LOG_INFO << "Operational description for module " << opDescript.name() << " / model " << opDescript.model();
+
+        if (opDescript.name() != "disconnect" &&
+            m_registry.Describe(module, opDescript.module_id().id(), opDescript.name())) {
+            StoreModule(module);
+        }
+
+        if (opDescript.name() == "disconnect") {
+            m_statusBoard.Disconnect(module);
+        }
+
+        m_mapmutex.lock();
+        if (opDescript.name() == "disconnect") {
+            try {
+                m_db << "delete from module_capabilities where module_id = ? ;" << module.guid;
+            } catch (exception &e) {
+                LOG_ERROR << e.what();
+            }
+        } else {
+            try {
+                m_db << "replace into module_capabilities (module_id, module_guid,"
+                        "module_name, description, "
+                        "manufacturer, model,"
+                        "module_version, serial_number,"
+                        "capabilities, source_time, receive_time, commit_time) "
+                        "values (?,?,?,?,?,?,?,?,?,?,?,?);"
+                     << opDescript.module_id().id() << module.guid
+                     << opDescript.name() << opDescript.description()
+                     << opDescript.manufacturer() << opDescript.model()
+                     << opDescript.module_version() << opDescript.serial_number()
+                     << opDescript.capabilities_schema().to_string()
+                     << times.source << times.receive << Clock::NowNs();
+            } catch (exception &e) {
+                LOG_ERROR << e.what();
+            }
+        }
+        m_mapmutex.unlock();
+
+    }
+
+    void ModuleManager::Process(AMM::Status &status, const ModuleRecord &module, const SampleTimes &times) {
+        m_statusBoard.SetCapability(module, status.module_name(), status.capability(),
+                                    AMM::Utility::EStatusValueStr(status.value()), status.message(),
+                                    status.timestamp());
+    }
+
+    void ModuleManager::SendTestCommand(const std::string action) {
+        AMM::Command cmdInstance;
+        cmdInstance.message(action);
+        m_mgr->WriteCommand(cmdInstance);
+    }
+
+    void ModuleManager::Process(AMM::Command &command, const ModuleRecord &module,
+                                const SampleTimes &times) {
+        std::ostringstream messageOut;
+
+        if (!command.message().compare(0, sysPrefix.size(), sysPrefix)) {
+            std::string value = command.message().substr(sysPrefix.size());
+            if (value.compare("START_SIM") == 0) {
+
+            } else if (value.compare("STOP_SIM") == 0) {
+
+            } else if (value.compare("PAUSE_SIM") == 0) {
+
+            } else if (value.compare("RESET_SIM") == 0) {
+
+            } else if (!value.compare(0, loadScenarioPrefix.size(), loadScenarioPrefix)) {
+                const std::string request = value.substr(loadScenarioPrefix.size());
+                const std::size_t manikin = request.find(";mid=");
+                currentScenario = request.substr(0, manikin);
+                LOG_INFO << "Load scenario command received for " << request;
+                // Publishing happens on the loader thread; other commands keep flowing meanwhile.
+                // A newer load only cancels one for the same manikin.
+                m_scenarioLoader.Submit(manikin == std::string::npos ? std::string() : request.substr(manikin + 5),
+                                        request);
+            } else if (!value.compare(0, loadPrefix.size(), loadPrefix)) {
+                currentState = value.substr(loadStatePrefix.size());
+            } else {
+                messageOut << "ACT" << "=" << command.message() << std::endl;
+                LOG_INFO << "Unknown system message: " << messageOut.str();
+            }
+        } else {
+            messageOut << "ACT"
+                       << "=" << command.message() << "|";
+            LOG_INFO << "Unknown message: " << messageOut.str();
+        }
+    }
+
+
+    void ModuleManager::WriteLogEntry(LogEntry &&newLogEntry) {
+        m_logWriter.Write(std::move(newLogEntry));
+    }
+
+    void ModuleManager::WriteModuleConfiguration(AMM::ModuleConfiguration &mc) {
+        TraceSpan span("WriteModuleConfiguration", "dds");
+        m_mgr->WriteModuleConfiguration(mc);
+    }
+
+    bool ModuleManager::LoadScenario(const std::string &request, const ScenarioLoader::Cancelled &cancelled) {
+        TraceSpan span("LoadScenario", "scenario");
+        const std::size_t pos = request.find(";mid=");
+        const std::string name = request.substr(0, pos);
+        LOG_INFO << " Scene is " << name;
+        if (pos != std::string::npos) {
+            LOG_INFO << " Manikin is " << request.substr(pos + 5);
+        }
+        auto isCancelled = [&] {
+            if (!cancelled || !cancelled()) {
+                return false;
+            }
+            LOG_INFO << "Load of " << name << " cancelled by a newer one.";
+            ReportScenarioLoad("CANCELLED " + name);
+            return true;
+        };
+
+        if (isCancelled()) {
+            return false;
+        }
+        // A miss compiles the file from disk, which is why this runs off the listener.
+        std::shared_ptr<const CompiledScenario> scenario = m_scenarios.Find(name);
+        if (!scenario) {
+            // The running simulation is left alone; only a scenario we can load resets it.
+            LOG_ERROR << "Unable to load scenario " << name;
+            ReportScenarioLoad("FAILED " + name + " unknown scenario", AMM::StatusValue::INOPERATIVE);
+            return false;
+        }
+        if (isCancelled()) {
+            return false;
+        }
+
+        LOG_INFO << "Sending simcontrol RESET";
+        AMM::SimulationControl simControl;
+        auto ms = duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+        simControl.timestamp(ms);
+        simControl.type(AMM::ControlType::RESET);
+        {
+            TraceSpan span("WriteSimulationControl", "dds");
+            m_mgr->WriteSimulationControl(simControl);
+        }
+        LOG_INFO << "Loading scenario: " << scenario->title;
+
+        std::size_t total = scenario->metadata.empty() ? 0 : 1;
+        for (const CompiledCapability &capability : scenario->capabilities) {
+            total += capability.configuration.empty() ? 0 : 1;
+        }
+        std::size_t published = 0;
+        const std::string steps = "/" + std::to_string(total);
+        ReportScenarioLoad("LOADING " + name + " 0" + steps);
+
+        AMM::ModuleConfiguration mc;
+        mc.timestamp(ms);
+        if (!scenario->metadata.empty()) {
+            LOG_INFO << "Sending out metadata";
+            mc.name("metadata");
+            mc.capabilities_configuration(scenario->metadata);
+            WriteModuleConfiguration(mc);
+            ReportScenarioLoad("LOADING " + name + " " + std::to_string(++published) + steps);
+        }
+
+        for (const CompiledCapability &capability : scenario->capabilities) {
+            if (capability.configuration.empty()) {
+                continue;
+            }
+            if (isCancelled()) {
+                return false;
+            }
+            LOG_INFO << "Publishing configuration for capability " << capability.name;
+            mc.name(capability.name);
+            mc.capabilities_configuration(capability.configuration);
+            WriteModuleConfiguration(mc);
+            ReportScenarioLoad("LOADING " + name + " " + std::to_string(++published) + steps);
+        }
+        ReportScenarioLoad("LOADED " + name);
+        return true;
+    }
+
+    void ModuleManager::ReportScenarioLoad(const std::string &message, AMM::StatusValue value) {
+        AMM::Status status;
+        status.module_id(m_uuid);
+        status.module_name(moduleName);
+        status.capability("scenario_load");
+        status.value(value);
+        status.message(message);
+        status.timestamp(duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count());
+        TraceSpan span("WriteStatus", "dds");
+        m_mgr->WriteStatus(status);
+    }
+
+}
@@ -1,144 +1,362 @@
-#pragma once
-
-#include "amm_std.h"
-
-#include "amm/Utility.h"
-
-#include "amm/TopicNames.h"
-
-#include <tinyxml2.h>
-
-#include "thirdparty/sqlite_modern_cpp.h"
-
-namespace AMM {
-
-/// Definition for Logs.
-    struct LogEntry {
-        std::string source;
-        std::string topic;
-        std::string event_id;
-        uint64_t timestamp;
-        std::string data = "";
-    };
-
-/// Container for Module Manager logic.
-    class ModuleManager : ListenerInterface {
-
-    public:
-
-
-    private:
-
-    protected:
-
-        /// This module's id.
-        AMM::UUID m_uuid;
-
-        /// This module's name.
-        std::string moduleName = "AMM_ModuleManager";
-
-        /// This module's path to the config file.
-        const std::string config_file = "config/module_manager_amm.xml";
-
-        /// DDS Manager for this module.
-        DDSManager <ModuleManager> *m_mgr = new DDSManager<ModuleManager>(config_file);
-
-        std::mutex m_mapmutex;
-
-    public:
-        ModuleManager();
-
-        ~ModuleManager();
-
-        void PublishOperationalDescription();
-
-        void PublishConfiguration();
-
-        void Shutdown();
-
-        void ShowStatus();
-
-        void WriteLogEntry(LogEntry log);
-
-        void ParseScenarioFromFile(const std::string xmlFileName);
-
-        void ClearEventLog();
-
-        void ClearDiagnosticLog();
-
-        void SendTestCommand(const std::string action);
-
-        std::string ExtractGUIDToString(GUID_t guid);
-
-        uint64_t GetTimestamp();
-
-    private:
-        /// Enables
-        void RunSimulation();
-
-        void HaltSimulation();
-
-        void ResetSimulation();
-
-        void SaveSimulation();
-
-        const std::string loadScenarioPrefix = "LOAD_SCENARIO:";
-        const std::string loadStatePrefix = "LOAD_STATE:";
-        const std::string sysPrefix = "[SYS]";
-        const std::string actPrefix = "[ACT]";
-        const std::string loadPrefix = "LOAD_STATE:";
-
-        std::string currentScenario = "NONE";
-        std::string currentState = "NONE";
-        std::string currentStatus = "NOT RUNNING";
-
-        bool isPaused = false;
-
-    protected:
-
-        /// Event listener for Logs.
-        void onNewLog(AMM::Log &log, SampleInfo_t *info);
-
-        /// Event listener for Module Configuration
-        void onNewModuleConfiguration(AMM::ModuleConfiguration &mc, SampleInfo_t *info);
-
-        /// Event listener for Status
-        void onNewStatus(AMM::Status &status, SampleInfo_t *info);
-
-        /// Event listener for Simulation Controller
-        void onNewSimulationControl(AMM::SimulationControl &simControl, SampleInfo_t *info);
-
-        /// Event listener for Assessment.
-        void onNewAssessment(AMM::Assessment &assessment, SampleInfo_t *info);
-
-        /// Event listener for Event Fragment.
-        void onNewEventFragment(AMM::EventFragment &eventFrag, SampleInfo_t *info);
-
-        /// Event listener for Event Record.
-        void onNewEventRecord(AMM::EventRecord &eventRec, SampleInfo_t *info);
-
-        /// Event listener for Fragment Amendment Request.
-        void onNewFragmentAmendmentRequest(AMM::FragmentAmendmentRequest &ffar, SampleInfo_t *info);
-
-        /// Event listener for Omitted Event.
-        void onNewOmittedEvent(AMM::OmittedEvent &omittedEvent, SampleInfo_t *info);
-
-        /// Event listener for Operational Description.
-        void onNewOperationalDescription(AMM::OperationalDescription &opDescript, SampleInfo_t *info);
-
-        /// Event listener for Render Modification.
-        void onNewRenderModification(AMM::RenderModification &rendMod, SampleInfo_t *info);
-
-        /// Event listener for Physiology Modification.
-        void onNewPhysiologyModification(AMM::PhysiologyModification &physMod, SampleInfo_t *info);
-
-        /// Event lsitener for Command.
-        void onNewCommand(AMM::Command &command, eprosima::fastrtps::SampleInfo_t *info);
-
-        void ParseCapabilities(tinyxml2::XMLElement *node);
-
-        void ParseMetadata(tinyxml2::XMLElement *node);
-    };
-
-
-} // namespace AMM
+#pragma once
+
+#include "amm_std.h"
+
+#include "amm/Utility.h"
+
+#include "amm/TopicNames.h"
+
+#include <tinyxml2.h>
+
+#include "thirdparty/sqlite_modern_cpp.h"
+
+#include "Bus.h"
+#include "BusCapture.h"
+#include "Clock.h"
+#include "ListenerWatchdog.h"
+#include "LogWriter.h"
+#include "Metrics.h"
+#include "ThreadPlacement.h"
+#include "Tracer.h"
+#include "ModuleRegistry.h"
+#include "ScenarioCache.h"
+#include "ScenarioLoader.h"
+#include "StatusBoard.h"
+#include "TopicTraits.h"
+
+namespace AMM {
+
+/// Container for Module Manager logic.
+    class ModuleManager : ListenerInterface {
+
+    public:
+
+
+    private:
+
+    protected:
+
+        /// This module's id.
+        AMM::UUID m_uuid;
+
+        /// This module's name.
+        std::string moduleName = "AMM_ModuleManager";
+
+        /// This module's path to the config file.
+        const std::string config_file = "config/module_manager_amm.xml";
+
+        /// Start of the current startup phase; declared first so participant creation is timed.
+        int64_t m_startupMark = Clock::NowNs();
+
+        /// Wall time spent in each startup phase, in order.
+        std::vector<std::pair<std::string, int64_t>> m_startupPhases;
+
+        /// DDS Manager for this module.
+        BusManager<ModuleManager> *m_mgr = new BusManager<ModuleManager>(config_file);
+
+        std::mutex m_mapmutex;
+
+        /// Connection for module tables; guarded by m_mapmutex.
+        sqlite::database m_db{"amm.db"};
+
+        /// Prepared TableStorage statements, indexed by TopicId.
+        std::unique_ptr<sqlite::database_binder> m_statements[TopicCount];
+
+        /// Writer GUID prefix -> module identity cache.
+        ModuleRegistry m_registry;
+
+        /// Runtime counters, gauges and histograms, exported in Prometheus text format.
+        MetricsRegistry m_metrics;
+        MetricsExporter m_metricsExporter{m_metrics};
+
+        /// Raw copy of every received sample, when recording.
+        CaptureWriter m_capture{&m_metrics};
+
+        /// Times subscription callbacks and reports ones that overrun their budget.
+        ListenerWatchdog m_watchdog{&m_metrics};
+
+        /// Per-topic metrics, indexed by TopicId.
+        Counter *m_samplesReceived[TopicCount];
+        Counter *m_bytesReceived[TopicCount];
+        Histogram *m_tableWriteSeconds[TopicCount] = {};
+
+        /// Per-topic latency through each stage of the ingest pipeline.
+        LatencyStats m_latency;
+
+        /// Batched writer for the events table.
+        LogWriter m_logWriter{"amm.db", m_mapmutex, &m_latency, &m_metrics};
+
+        /// In-memory state behind the status console.
+        StatusBoard m_statusBoard;
+
+        /// Compiled scenarios, preloaded at startup, behind LOAD_SCENARIO.
+        ScenarioCache m_scenarios;
+
+        /// Publishes LOAD_SCENARIO requests off the Command listener, newest first.
+        ScenarioLoader m_scenarioLoader{[this](const std::string &request, const ScenarioLoader::Cancelled &cancelled) {
+            LoadScenario(request, cancelled);
+        }};
+
+        /// Called when a sample arrives from a participant the registry does not know yet.
+        std::function<void()> m_onNewPeer;
+
+        /// Cleared when shutdown starts; samples arriving afterwards are counted and ignored.
+        std::atomic<bool> m_accepting{true};
+        std::atomic<uint64_t> m_rejected{0};
+        std::atomic<bool> m_shutDown{false};
+
+        /// Guards the startup phases and the new-peer callback.
+        std::mutex m_startupMutex;
+
+    public:
+        ModuleManager();
+
+        ~ModuleManager();
+
+        void PublishOperationalDescription();
+
+        void PublishConfiguration();
+
+        /// Stops taking samples, then drains and commits what is queued, giving up once
+        /// `deadline` has passed. Only the first call does anything.
+        void Shutdown(std::chrono::milliseconds deadline = std::chrono::milliseconds(2000));
+
+        void ShowStatus();
+
+        /// Takes and publishes a new status snapshot. Reads only in-memory state.
+        std::shared_ptr<const StatusSnapshot> RefreshStatus();
+
+        const StatusBoard &Status() const { return m_statusBoard; }
+
+        /// Writes the full latency distributions to a file.
+        bool DumpLatency(const std::string &fileName);
+
+        /// Periodically rewrites a Prometheus text file with the current metrics.
+        void StartMetricsExport(const std::string &fileName,
+                                std::chrono::milliseconds interval = std::chrono::milliseconds(5000));
+
+        BusManager<ModuleManager> &Bus() { return *m_mgr; }
+
+        const LatencyStats &Latency() const { return m_latency; }
+
+        const MetricsRegistry &Metrics() const { return m_metrics; }
+
+        const ModuleRegistry &Registry() const { return m_registry; }
+
+        /// Forgets the modules that sent nothing since the previous call, with their metric series.
+        /// Their rows stay in the modules table. Call it every few minutes.
+        void EvictIdleModules();
+
+        /// Creates any missing tables, then wipes them as WipeTables() does.
+        bool SetupTables(std::string *error = nullptr);
+
+        /// Deletes every stored row in one transaction on the manager's connection, with the table
+        /// and log writers held off, then stores the modules still known. On failure `error`, if
+        /// given, receives the reason and nothing is deleted.
+        bool WipeTables(std::string *error = nullptr);
+
+        /// Records every received sample, serialized, to a capture file for later replay.
+        bool StartRecording(const std::string &fileName);
+
+        void StopRecording();
+
+        /// Time a subscription callback may take before the watchdog reports it.
+        void SetListenerBudget(std::chrono::milliseconds budget);
+
+        void WriteLogEntry(LogEntry &&log);
+
+        /// Runs `callback` on the listener thread whenever a sample arrives from a participant the
+        /// registry has not seen before. DDSManager does not expose our writers' matched status, so
+        /// this is the sign that a new reader of our announcement may have appeared.
+        void OnNewPeer(std::function<void()> callback);
+
+        /// Closes the current startup phase, charging the time since the previous one to `phase`.
+        void MarkStartupPhase(const std::string &phase);
+
+        /// Logs the time spent in each startup phase.
+        void ReportStartup();
+
+        /// Resets the simulation and publishes a scenario's metadata and capability
+        /// configurations from the cache, reporting progress on Status. `request` is a
+        /// LOAD_SCENARIO argument, `<scenario>[;mid=<manikin>]`. Returns false if the
+        /// scenario is unknown or the load was cancelled.
+        bool LoadScenario(const std::string &request,
+                          const ScenarioLoader::Cancelled &cancelled = ScenarioLoader::Cancelled());
+
+        ScenarioCache &Scenarios() { return m_scenarios; }
+
+        void ClearEventLog();
+
+        void ClearDiagnosticLog();
+
+        void SendTestCommand(const std::string action);
+
+        /// Source timestamp in milliseconds, falling back to now for samples without one.
+        uint64_t SourceTimestamp(const SampleTimes &times);
+
+        /// Identity of the module that published a sample; cached after first sight.
+        const ModuleRecord &ResolveModule(SampleInfo_t *info);
+
+        /// Wall clock time in milliseconds, the unit of every timestamp column.
+        uint64_t GetTimestamp();
+
+    private:
+        /// Enables
+        void RunSimulation();
+
+        void HaltSimulation();
+
+        void ResetSimulation();
+
+        void SaveSimulation();
+
+        const std::string loadScenarioPrefix = "LOAD_SCENARIO:";
+        const std::string loadStatePrefix = "LOAD_STATE:";
+        const std::string sysPrefix = "[SYS]";
+        const std::string actPrefix = "[ACT]";
+        const std::string loadPrefix = "LOAD_STATE:";
+
+        std::string currentScenario = "NONE";
+        std::string currentState = "NONE";
+        std::string currentStatus = "NOT RUNNING";
+
+        bool isPaused = false;
+
+    protected:
+
+        /// Event listener for every subscribed topic. Tracing, module resolution,
+        /// storage and reactions are all resolved at compile time from TopicTraits.
+        template<typename Topic>
+        void onNewSample(Topic &sample, SampleInfo_t *info);
+
+        /// Topic-specific reactions, run once a sample has been stored.
+        template<typename Topic>
+        void Process(Topic &, const ModuleRecord &, const SampleTimes &) {}
+
+        void Process(AMM::SimulationControl &simControl, const ModuleRecord &module, const SampleTimes &times);
+
+        void Process(AMM::OperationalDescription &opDescript, const ModuleRecord &module, const SampleTimes &times);
+
+        void Process(AMM::Command &command, const ModuleRecord &module, const SampleTimes &times);
+
+        void Process(AMM::Status &status, const ModuleRecord &module, const SampleTimes &times);
+
+        template<typename Topic>
+        void Store(const Topic &sample, const ModuleRecord &module, const SampleTimes &times, EventStorage);
+
+        template<typename Topic>
+        void Store(const Topic &sample, const ModuleRecord &module, const SampleTimes &times, TableStorage);
+
+        template<typename Topic>
+        void Store(const Topic &, const ModuleRecord &, const SampleTimes &, NoStorage) {}
+
+        void LoadModuleRegistry();
+
+        void StoreModule(const ModuleRecord &module);
+
+        /// Rewrites the modules table from the registry after a wipe.
+        void StoreModules();
+
+        void RegisterMetrics();
+
+        /// Publishes a configuration, traced as its own span.
+        void WriteModuleConfiguration(AMM::ModuleConfiguration &mc);
+
+        /// Publishes the state of a scenario load on the scenario_load capability; a failed load is
+        /// reported INOPERATIVE.
+        void ReportScenarioLoad(const std::string &message,
+                                AMM::StatusValue value = AMM::StatusValue::OPERATIONAL);
+    };
+
+
+    template<typename Topic>
+    void ModuleManager::onNewSample(Topic &sample, SampleInfo_t *info) {
+        if (!m_accepting.load(std::memory_order_relaxed)) {
+            m_rejected.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        const SampleTimes times{Clock::SourceNs(info), Clock::NowNs()};
+
+        typedef TopicTraits<Topic> Traits;
+        // DDS owns the receive threads and shares them between topics; place each one the first
+        // time it calls us, and raise it to Control only while it handles a control sample.
+        ThreadPlacement::Adopt(ThreadRole::Listener);
+        ThreadPlacement::Elevation elevation(
+                Traits::Id == TopicId::SimulationControl ? ThreadRole::Control : ThreadRole::Listener);
+        ListenerWatchdog::Scope watch(m_watchdog, Traits::Id);
+        TraceSpan span(TopicName(Traits::Id).c_str(), "listener");
+        const std::size_t topicIndex = static_cast<std::size_t>(Traits::Id);
+        const std::size_t bytes = Topic::getCdrSerializedSize(sample);
+        m_samplesReceived[topicIndex]->Increment();
+        m_bytesReceived[topicIndex]->Increment(bytes);
+
+        // Recorded before filtering, so a capture holds everything the bus delivered.
+        if (m_capture.Active()) {
+            m_capture.Record(Traits::Id, sample, info, times);
+        }
+
+        if (!Traits::Accept(sample)) {
+            return;
+        }
+        LOG_TRACE << Traced(sample);
+
+        if (times.source > 0) {
+            m_latency.Record(Traits::Id, LatencyStage::SourceToCallback, times.receive - times.source);
+        }
+
+        const ModuleRecord &module = ResolveModule(info);
+        module.samples->Increment();
+        module.bytes->Increment(bytes);
+
+        Store(sample, module, times, typename Traits::Storage());
+        Process(sample, module, times);
+    }
+
+    template<typename Topic>
+    void ModuleManager::Store(const Topic &sample, const ModuleRecord &module, const SampleTimes &times,
+                              EventStorage) {
+        typedef TopicTraits<Topic> Traits;
+        std::string &data = ScratchBuffer();
+        Traits::Format(sample, data);
+        WriteLogEntry({module.guid, module.key, Traits::Id, Traits::EventId(sample),
+                       Traits::Timestamp(sample, SourceTimestamp(times)), data, times});
+    }
+
+    template<typename Topic>
+    void ModuleManager::Store(const Topic &sample, const ModuleRecord &module, const SampleTimes &times,
+                              TableStorage) {
+        typedef TopicTraits<Topic> Traits;
+        TraceSpan span("WriteModuleTable", "db");
+        std::lock_guard<std::mutex> lock(m_mapmutex);
+        const int64_t dequeueTime = Clock::NowNs();
+        m_latency.Record(Traits::Id, LatencyStage::CallbackToDequeue, dequeueTime - times.receive);
+
+        const std::size_t topicIndex = static_cast<std::size_t>(Traits::Id);
+        if (m_tableWriteSeconds[topicIndex] == nullptr) {
+            m_tableWriteSeconds[topicIndex] = &m_metrics.AddHistogram(
+                    "amm_table_write_duration_seconds", "Time to write one sample to its module table.",
+                    {{"topic", TopicName(Traits::Id)}}, {0.0001, 0.0005, 0.001, 0.005, 0.01, 0.05, 0.1, 0.5});
+        }
+
+        std::unique_ptr<sqlite::database_binder> &statement = m_statements[topicIndex];
+        try {
+            if (!statement) {
+                statement.reset(new sqlite::database_binder(m_db << Traits::Statement()));
+            }
+            Traits::Bind(*statement, sample, module);
+            *statement << times.source << times.receive << Clock::NowNs();
+            statement->execute();
+            const int64_t duration = Clock::NowNs() - dequeueTime;
+            m_latency.Record(Traits::Id, LatencyStage::DequeueToCommit, duration);
+            m_tableWriteSeconds[topicIndex]->Observe(static_cast<double>(duration) / 1e9);
+        } catch (std::exception &e) {
+            LOG_ERROR << e.what();
+            if (statement) {
+                // Drop the statement without running its half-bound parameters.
+                statement->used(true);
+                statement.reset();
+            }
+        }
+    }
+
+} // namespace AMM
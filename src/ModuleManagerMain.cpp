@@ -1,206 +1,569 @@
-#include "ModuleManager.h"
-
-#include "thirdparty/sqlite_modern_cpp.h"
-
-#include "amm/BaseLogger.h"
-
-using namespace std;
-using namespace sqlite;
-
-
-bool closed = false;
-int daemonize = 0;
-bool setup = false;
-int autostart = 0;
-bool wipe = false;
-
-/// Clears database tables.
-void WipeTables() {
-    try {
-        sqlite_config config;
-        database db("amm.db", config);
-
-        db << "delete from events;";
-        db << "delete from module_capabilities;";
-        db << "delete from module_status;";
-        db << "delete from logs;";
-
-    } catch (exception &e) {
-        LOG_ERROR << e.what();
-    }
-
-}
-
-/// On start initialization for database tables.
-void SetupTables() {
-
-    try {
-        sqlite_config config;
-        database db("amm.db", config);
-
-        LOG_INFO << "Creating event log table...";
-        db << "create table if not exists events("
-              "source text,"
-              "module_id text,"
-              "module_guid text,"
-              "module_name text,"
-              "event_id text,"
-              "topic text,"
-              "timestamp bigint,"
-              "data text"
-              ");";
-
-        LOG_INFO << "Creating module capabilities table...";
-        db << "create table if not exists module_capabilities ("
-              "module_id text,"
-              "module_guid text,"
-              "module_name text,"
-              "description text,"
-              "manufacturer text,"
-              "model text,"
-              "module_version text,"
-              "serial_number text,"
-              "capabilities text"
-              ");";
-
-        LOG_INFO << "Creating module status table...";
-        db << "create table if not exists module_status ("
-              "module_id text,"
-              "module_guid text,"
-              "module_name text,"
-              "capability text,"
-              "status text,"
-              "message text,"
-              "timestamp bigint,"
-              "encounter_id text"
-              ");";
-
-        LOG_INFO << "Creating log record table...";
-        db << "create table if not exists logs("
-              "module_id text,"
-              "module_guid text,"
-              "module_name text,"
-              "message text,"
-              "log_level text,"
-              "timestamp bigint"
-              ");";
-
-    } catch (exception &e) {
-        LOG_ERROR << e.what();
-    }
-
-    WipeTables();
-}
-
-/// Displays current manager configuration.
-static void ShowUsage(const std::string &name) {
-    cerr << "Usage: " << name << " <option(s)>"
-         << "\nOptions:\n"
-         << "\t-a\t\t\tAuto start\n"
-         << "\t-d\t\t\tDaemonize\n"
-         << "\t-s\t\t\tSetup module manager tables\n"
-         << "\t-w\t\t\tWipe tables\n"
-         << "\t-h,--help\t\t\tShow this help message\n"
-         << endl;
-}
-
-/// Main menu for Module Manager.
-void ShowMenu(AMM::ModuleManager *modManager) {
-    string action;
-
-    cout << endl;
-    cout << " [1]Status " << endl;
-    cout << " [2]Setup tables" << endl;
-    cout << " [3]Wipe tables" << endl;
-    cout << " [4]Shutdown" << endl;
-    cout << " [5]Test scenario file loading" << endl;
-    cout << " >> ";
-
-    getline(cin, action);
-
-    transform(action.begin(), action.end(), action.begin(), ::toupper);
-
-    if (action == "1") {
-        modManager->ShowStatus();
-    } else if (action == "2") {
-        SetupTables();
-    } else if (action == "3") {
-        WipeTables();
-    } else if (action == "4") {
-        LOG_INFO << "Shutting down Module Manager.";
-        closed = true;
-        modManager->Shutdown();
-    } else if (action == "5") {
-        LOG_INFO << "Loading scenario file via COMMAND";
-        modManager->SendTestCommand("[SYS]LOAD_SCENARIO:BVM");
-    } else if (action == "6") { 
-	LOG_INFO << "Loading scenario file via COMMAND for manikin 1";
-        modManager->SendTestCommand("[SYS]LOAD_SCENARIO:BVM;mid=manikin_1");
-
-    } else {
-            /// TODO: Unknown menu action.
-
-    }
-}
-
-/// Main program
-int main(int argc, char *argv[]) {
-    static plog::ColorConsoleAppender <plog::TxtFormatter> consoleAppender;
-    plog::init(plog::verbose, &consoleAppender);
-
-    LOG_INFO << "AMM - Module Manager";
-
-    for (int i = 1; i < argc; ++i) {
-        string arg = argv[i];
-
-        if ((arg == "-h") || (arg == "--help")) {
-            ShowUsage(argv[0]);
-            return 0;
-        }
-
-        if (arg == "-d") {
-            daemonize = 1;
-        }
-
-        if (arg == "-a") {
-            autostart = 1;
-        }
-
-        if (arg == "-s") {
-            setup = true;
-        }
-
-        if (arg == "-w") {
-            wipe = true;
-        }
-    }
-
-    if (setup) {
-        LOG_INFO << "Creating AMM database schema.";
-        SetupTables();
-    }
-
-    if (wipe) {
-        LOG_INFO << "Wiping tables on startup";
-        WipeTables();
-    }
-
-    AMM::ModuleManager modManager;
-
-    std::this_thread::sleep_for(std::chrono::milliseconds(250));
-
-    modManager.PublishOperationalDescription();
-    modManager.PublishConfiguration();
-
-    while (!closed) {
-        if (autostart != 1) {
-            ShowMenu(&modManager);
-        }
-        std::this_thread::sleep_for(std::chrono::milliseconds(250));
-    }
-
-    modManager.Shutdown();
-    LOG_INFO << "Exiting.";
-
-    return 0;
-}
+#include "ModuleManager.h"
+
+#include "AdminServer.h"
+#include "EventLoop.h"
+#include "Schema.h"
+#include "SqlProfiler.h"
+#include "ThreadPlacement.h"
+
+#include "thirdparty/sqlite_modern_cpp.h"
+
+#include "amm/BaseLogger.h"
+
+#include <plog/Appenders/RollingFileAppender.h>
+
+#include <atomic>
+#include <csignal>
+#include <fstream>
+
+#ifdef __unix__
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+using namespace sqlite;
+
+
+int daemonize = 0;
+string pidFile = "amm_module_manager.pid";
+const string daemonLogFile = "amm_module_manager.log";
+bool setup = false;
+int autostart = 0;
+bool wipe = false;
+string metricsFile;
+string captureFile;
+int listenerBudget = 0;
+int shutdownDeadline = 2000;
+string threadsFile = "config/module_manager_threads.xml";
+string adminSocket;
+bool tracing = false;
+bool profileSql = false;
+const string traceFile = "amm_trace.json";
+
+/// Redraws the live status view while it is showing; 0 when the menu is up.
+int liveStatusTimer = 0;
+
+/// Modules that send nothing for between one and two of these are forgotten.
+const std::chrono::minutes moduleIdleInterval(5);
+
+/// Clears database tables before the manager starts; a running manager wipes through its own connection.
+bool WipeTables() {
+    try {
+        sqlite_config config;
+        database db("amm.db", config);
+        AMM::SqlProfiler::Attach(db.connection().get());
+        sqlite3_busy_timeout(db.connection().get(), AMM::BusyTimeoutMs);
+
+        return AMM::WipeTables(db.connection().get());
+
+    } catch (exception &e) {
+        LOG_ERROR << e.what();
+        return false;
+    }
+}
+
+/// On start initialization for database tables.
+bool SetupTables() {
+
+    try {
+        sqlite_config config;
+        database db("amm.db", config);
+        AMM::SqlProfiler::Attach(db.connection().get());
+        sqlite3_busy_timeout(db.connection().get(), AMM::BusyTimeoutMs);
+
+        if (!AMM::CreateTables(db.connection().get())) {
+            return false;
+        }
+
+    } catch (exception &e) {
+        LOG_ERROR << e.what();
+        return false;
+    }
+
+    return WipeTables();
+}
+
+/// Displays current manager configuration.
+static void ShowUsage(const std::string &name) {
+    cerr << "Usage: " << name << " <option(s)>"
+         << "\nOptions:\n"
+         << "\t-a\t\t\tAuto start\n"
+         << "\t-d\t\t\tDaemonize, logging to " << daemonLogFile << "\n"
+         << "\t-P <file>\t\tPID file when daemonized (default " << pidFile << ")\n"
+         << "\t-s\t\t\tSetup module manager tables\n"
+         << "\t-w\t\t\tWipe tables\n"
+         << "\t-m <file>\t\tPeriodically write Prometheus metrics to <file>\n"
+         << "\t-b <ms>\t\t\tWarn about listener callbacks running longer than <ms> (default 100)\n"
+         << "\t-g <ms>\t\t\tOn shutdown, drain queued samples for at most <ms> (default " << shutdownDeadline
+         << ")\n"
+         << "\t-c <path>\t\tServe admin requests on a Unix socket at <path>\n"
+         << "\t-T <file>\t\tThread affinity and scheduling per role (default " << threadsFile << ")\n"
+         << "\t-r <file>\t\tRecord every received sample to a capture file for amm_bus_replay\n"
+         << "\t-p\t\t\tProfile SQL statements\n"
+         << "\t-t\t\t\tRecord a Chrome trace (written to " << traceFile << ")\n"
+         << "\t-h,--help\t\t\tShow this help message\n"
+         << endl;
+}
+
+/// Takes an exclusive lock on the PID file, so a second daemon refuses to start.
+/// flock() locks belong to the open file, so the lock survives Daemonize()'s forks.
+int LockPidFile(const string &fileName) {
+#ifdef __unix__
+    int fd = open(fileName.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        LOG_ERROR << "Unable to open PID file " << fileName;
+        return -1;
+    }
+    if (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+        LOG_ERROR << "Another Module Manager holds " << fileName;
+        close(fd);
+        return -1;
+    }
+    return fd;
+#else
+    return -1;
+#endif
+}
+
+/// Records this process's id in the locked PID file.
+void WritePidFile(int fd) {
+#ifdef __unix__
+    const string pid = to_string(getpid()) + "\n";
+    if (ftruncate(fd, 0) != 0 || write(fd, pid.data(), pid.size()) != static_cast<ssize_t>(pid.size())) {
+        LOG_WARNING << "Unable to write PID file " << pidFile;
+    }
+#endif
+}
+
+/// Unlinks and closes the locked PID file when main returns, on error paths as well as on
+/// a clean shutdown, so no return leaves a stale PID file behind.
+struct PidFileRelease {
+    int &fd;
+
+    ~PidFileRelease() {
+#ifdef __unix__
+        if (fd >= 0) {
+            unlink(pidFile.c_str());
+            close(fd);
+            fd = -1;
+        }
+#endif
+    }
+};
+
+/// Detaches from the controlling terminal. The working directory is kept, since
+/// amm.db and the participant profiles are opened relative to it.
+bool Daemonize() {
+#ifdef __unix__
+    pid_t pid = fork();
+    if (pid < 0) {
+        return false;
+    }
+    if (pid > 0) {
+        _exit(0);
+    }
+    setsid();
+
+    // Fork again so the daemon is not a session leader and can never reacquire a terminal.
+    pid = fork();
+    if (pid < 0) {
+        return false;
+    }
+    if (pid > 0) {
+        _exit(0);
+    }
+
+    umask(022);
+    int null = open("/dev/null", O_RDWR);
+    if (null >= 0) {
+        dup2(null, STDIN_FILENO);
+        dup2(null, STDOUT_FILENO);
+        dup2(null, STDERR_FILENO);
+        if (null > STDERR_FILENO) {
+            close(null);
+        }
+    }
+    return true;
+#else
+    LOG_ERROR << "Daemon mode is only supported on POSIX systems.";
+    return false;
+#endif
+}
+
+/// Main menu for Module Manager.
+void ShowMenu() {
+    cout << endl;
+    cout << " [1]Status " << endl;
+    cout << " [L]Live status" << endl;
+    cout << " [2]Setup tables" << endl;
+    cout << " [3]Wipe tables" << endl;
+    cout << " [4]Shutdown" << endl;
+    cout << " [5]Test scenario file loading" << endl;
+    cout << " [7]Dump latency histograms" << endl;
+    cout << " [8]" << (AMM::Tracer::Enabled() ? "Dump trace" : "Start tracing") << endl;
+    if (AMM::SqlProfiler::Enabled()) {
+        cout << " [9]SQL statement profile" << endl;
+    }
+    cout << " >> " << flush;
+}
+
+/// Redraws the status page from a fresh in-memory snapshot.
+void ShowLiveStatus(AMM::ModuleManager *modManager) {
+    ostringstream page;
+    AMM::PrintStatus(*modManager->RefreshStatus(), page);
+    cout << "\033[2J\033[H" << page.str() << endl << "Press Enter to return to the menu." << flush;
+}
+
+/// Runs one menu selection. Returns false if the menu should not be shown again yet.
+bool HandleMenuAction(AMM::ModuleManager *modManager, AMM::EventLoop *loop, string action) {
+    if (liveStatusTimer != 0) {
+        // Any input leaves the live view.
+        loop->CancelTimer(liveStatusTimer);
+        liveStatusTimer = 0;
+        return true;
+    }
+
+    transform(action.begin(), action.end(), action.begin(), ::toupper);
+
+    if (action == "1") {
+        modManager->ShowStatus();
+    } else if (action == "L") {
+        liveStatusTimer = loop->AddTimer(std::chrono::milliseconds(0), std::chrono::milliseconds(1000),
+                                         [modManager] { ShowLiveStatus(modManager); });
+        return false;
+    } else if (action == "2") {
+        modManager->SetupTables();
+    } else if (action == "3") {
+        modManager->WipeTables();
+    } else if (action == "4") {
+        LOG_INFO << "Shutting down Module Manager.";
+        loop->Stop();
+    } else if (action == "5") {
+        LOG_INFO << "Loading scenario file via COMMAND";
+        modManager->SendTestCommand("[SYS]LOAD_SCENARIO:BVM");
+    } else if (action == "6") { 
+	LOG_INFO << "Loading scenario file via COMMAND for manikin 1";
+        modManager->SendTestCommand("[SYS]LOAD_SCENARIO:BVM;mid=manikin_1");
+
+    } else if (action == "7") {
+        modManager->DumpLatency("latency.hgrm");
+    } else if (action == "8") {
+        if (AMM::Tracer::Enabled()) {
+            AMM::Tracer::Dump(traceFile);
+            LOG_INFO << "Trace written to " << traceFile;
+        } else {
+            AMM::Tracer::Enable(true);
+            LOG_INFO << "Tracing enabled.";
+        }
+    } else if (action == "9" && AMM::SqlProfiler::Enabled()) {
+        cout << endl;
+        AMM::SqlProfiler::PrintReport(cout);
+    } else {
+            /// TODO: Unknown menu action.
+
+    }
+    return true;
+}
+
+/// Reads menu selections from stdin as they arrive, without blocking the event loop.
+void WatchMenuInput(AMM::ModuleManager *modManager, AMM::EventLoop *loop) {
+#ifdef __unix__
+    // Read the descriptor directly: lines left in cin's buffer would not wake the loop.
+    auto pending = make_shared<string>();
+    bool watched = loop->Watch(STDIN_FILENO, [modManager, loop, pending] {
+        char buffer[256];
+        ssize_t count = read(STDIN_FILENO, buffer, sizeof(buffer));
+        if (count <= 0) {
+            LOG_INFO << "Standard input closed, menu disabled.";
+            loop->Unwatch(STDIN_FILENO);
+            return;
+        }
+        pending->append(buffer, static_cast<size_t>(count));
+
+        size_t end;
+        while ((end = pending->find('\n')) != string::npos && !loop->Stopped()) {
+            string action = pending->substr(0, end);
+            pending->erase(0, end + 1);
+            if (HandleMenuAction(modManager, loop, action) && !loop->Stopped()) {
+                ShowMenu();
+            }
+        }
+    });
+    if (watched) {
+        return;
+    }
+#endif
+    // No descriptor polling here; read on a helper thread and hand each line to the loop.
+    thread([modManager, loop] {
+        string action;
+        while (getline(cin, action)) {
+            loop->Post([modManager, loop, action] {
+                if (HandleMenuAction(modManager, loop, action) && !loop->Stopped()) {
+                    ShowMenu();
+                }
+            });
+        }
+    }).detach();
+}
+
+/// Exposes the menu's actions, plus metrics and registry dumps, on the admin socket.
+void AddAdminCommands(AMM::AdminServer &admin, AMM::ModuleManager *modManager, AMM::EventLoop *loop) {
+    admin.AddCommand("status", "Modules, capabilities, topic rates, queues and last error",
+                     [modManager](const string &, ostream &out) {
+                         AMM::PrintStatus(*modManager->RefreshStatus(), out);
+                         return true;
+                     });
+    admin.AddCommand("modules", "Known modules: key, GUID, module id, name, samples",
+                     [modManager](const string &, ostream &out) {
+                         modManager->Registry().ForEach([&out](const AMM::ModuleRecord &module) {
+                             out << module.key << "\t" << module.guid << "\t" << module.module_id << "\t"
+                                 << module.name << "\t" << (module.samples ? module.samples->Value() : 0) << "\n";
+                         });
+                         return true;
+                     });
+    admin.AddCommand("metrics", "All metrics in Prometheus text format", [modManager](const string &, ostream &out) {
+        modManager->Metrics().WritePrometheus(out);
+        return true;
+    });
+    admin.AddCommand("latency", "Ingest latency summary per topic and stage",
+                     [modManager](const string &, ostream &out) {
+                         modManager->Latency().PrintSummary(out);
+                         return true;
+                     });
+    admin.AddCommand("setup", "Create the database tables, then wipe them", [modManager](const string &, ostream &out) {
+        string error;
+        if (!modManager->SetupTables(&error)) {
+            out << error;
+            return false;
+        }
+        return true;
+    });
+    admin.AddCommand("wipe", "Delete all rows from the event, capability, status, log and module tables",
+                     [modManager](const string &, ostream &out) {
+                         string error;
+                         if (!modManager->WipeTables(&error)) {
+                             out << error;
+                             return false;
+                         }
+                         return true;
+                     });
+    admin.AddCommand("load", "load <scenario>[;mid=<manikin>]: send a LOAD_SCENARIO command",
+                     [modManager](const string &scenario, ostream &out) {
+                         if (scenario.empty()) {
+                             out << "usage: load <scenario>";
+                             return false;
+                         }
+                         LOG_INFO << "Loading scenario " << scenario << " via admin socket";
+                         modManager->SendTestCommand("[SYS]LOAD_SCENARIO:" + scenario);
+                         return true;
+                     });
+    admin.AddCommand("shutdown", "Drain and exit", [loop](const string &, ostream &) {
+        LOG_INFO << "Shutdown requested via admin socket.";
+        loop->Stop();
+        return true;
+    });
+}
+
+/// Main program
+int main(int argc, char *argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+
+        if ((arg == "-h") || (arg == "--help")) {
+            ShowUsage(argv[0]);
+            return 0;
+        }
+
+        if (arg == "-d") {
+            daemonize = 1;
+        }
+
+        if (arg == "-P" && i + 1 < argc) {
+            pidFile = argv[++i];
+        }
+
+        if (arg == "-a") {
+            autostart = 1;
+        }
+
+        if (arg == "-s") {
+            setup = true;
+        }
+
+        if (arg == "-w") {
+            wipe = true;
+        }
+
+        if (arg == "-p") {
+            profileSql = true;
+        }
+
+        if (arg == "-t") {
+            tracing = true;
+        }
+
+        if (arg == "-b" && i + 1 < argc) {
+            listenerBudget = atoi(argv[++i]);
+        }
+
+        if (arg == "-g" && i + 1 < argc) {
+            shutdownDeadline = atoi(argv[++i]);
+        }
+
+        if (arg == "-c" && i + 1 < argc) {
+            adminSocket = argv[++i];
+        }
+
+        if (arg == "-T" && i + 1 < argc) {
+            threadsFile = argv[++i];
+        }
+
+        if (arg == "-m" && i + 1 < argc) {
+            metricsFile = argv[++i];
+        }
+
+        if (arg == "-r" && i + 1 < argc) {
+            captureFile = argv[++i];
+        }
+    }
+
+    static AMM::LastErrorAppender errorAppender;
+    if (daemonize == 1) {
+        static plog::RollingFileAppender <plog::TxtFormatter> fileAppender(daemonLogFile.c_str(), 10 * 1024 * 1024, 3);
+        plog::init(plog::info, &fileAppender).addAppender(&errorAppender);
+    } else {
+        static plog::ColorConsoleAppender <plog::TxtFormatter> consoleAppender;
+        plog::init(plog::verbose, &consoleAppender).addAppender(&errorAppender);
+    }
+
+    int pidFd = -1;
+    PidFileRelease pidRelease{pidFd};
+    if (daemonize == 1) {
+        // Locked before forking, so a clash is reported to the shell that started us.
+        pidFd = LockPidFile(pidFile);
+        if (pidFd < 0) {
+            cerr << "Unable to lock " << pidFile << ", is another Module Manager running?" << endl;
+            return 1;
+        }
+        if (!Daemonize()) {
+            cerr << "Unable to daemonize." << endl;
+            return 1;
+        }
+        WritePidFile(pidFd);
+        autostart = 1;
+    }
+
+    LOG_INFO << "AMM - Module Manager";
+
+    // Blocks the shutdown signals before any thread starts, so they all reach the loop.
+    AMM::EventLoop loop;
+    if (!loop.Open()) {
+        return 1;
+    }
+    loop.OnSignal([&loop](int signal) {
+        if (signal == SIGHUP && daemonize == 1) {
+            return;
+        }
+        LOG_INFO << "Shutting down Module Manager.";
+        loop.Stop();
+    });
+
+    AMM::SqlProfiler::Enable(profileSql);
+
+    if (tracing) {
+        AMM::Tracer::Enable(true);
+    }
+
+    // Before the manager starts its threads, so each picks up its role's placement.
+    if (ifstream(threadsFile).good()) {
+        AMM::ThreadPlacement::Load(threadsFile);
+    }
+    AMM::ThreadPlacement::Apply(AMM::ThreadRole::Main, "main");
+
+    if (setup) {
+        LOG_INFO << "Creating AMM database schema.";
+        SetupTables();
+    }
+
+    if (wipe) {
+        LOG_INFO << "Wiping tables on startup";
+        WipeTables();
+    }
+
+    // Opened before the manager starts, so a clash stops us before we join the bus.
+    AMM::AdminServer admin(loop);
+    if (!adminSocket.empty() && !admin.Open(adminSocket)) {
+        return 1;
+    }
+
+    AMM::ModuleManager modManager;
+
+    if (listenerBudget > 0) {
+        modManager.SetListenerBudget(std::chrono::milliseconds(listenerBudget));
+    }
+
+    if (!metricsFile.empty()) {
+        modManager.StartMetricsExport(metricsFile);
+    }
+
+    if (!captureFile.empty()) {
+        modManager.StartRecording(captureFile);
+    }
+
+    // Announce at once. DDSManager does not expose our writers' matched status, so announce again
+    // whenever a participant we have not heard from shows up: its readers may have matched after
+    // the last announcement. Bursts of new participants share one republish.
+    modManager.PublishOperationalDescription();
+    modManager.PublishConfiguration();
+    modManager.MarkStartupPhase("announce");
+    modManager.ReportStartup();
+    {
+        ostringstream threads;
+        AMM::ThreadPlacement::Report(threads);
+        LOG_INFO << "Thread layout:\n" << threads.str();
+    }
+    if (autostart != 1) {
+        ShowMenu();
+    }
+    auto announcePending = make_shared<std::atomic<bool>>(false);
+    modManager.OnNewPeer([&loop, &modManager, announcePending] {
+        if (announcePending->exchange(true)) {
+            return;
+        }
+        loop.Post([&modManager, announcePending] {
+            announcePending->store(false);
+            LOG_DEBUG << "New participant discovered, announcing again.";
+            modManager.PublishOperationalDescription();
+            modManager.PublishConfiguration();
+        });
+    });
+    loop.AddTimer(moduleIdleInterval, moduleIdleInterval, [&modManager] { modManager.EvictIdleModules(); });
+    if (autostart != 1) {
+        WatchMenuInput(&modManager, &loop);
+    }
+
+    if (!adminSocket.empty()) {
+        AddAdminCommands(admin, &modManager, &loop);
+    }
+
+    loop.Run();
+
+    admin.Close();
+
+    modManager.Shutdown(std::chrono::milliseconds(shutdownDeadline));
+    if (AMM::SqlProfiler::Enabled()) {
+        std::ostringstream report;
+        AMM::SqlProfiler::PrintReport(report, 50);
+        LOG_INFO << "SQL statement profile:\n" << report.str();
+    }
+    if (AMM::Tracer::Enabled()) {
+        AMM::Tracer::Dump(traceFile);
+        LOG_INFO << "Trace written to " << traceFile;
+    }
+    LOG_INFO << "Exiting.";
+
+    return 0;
+}
@@ -0,0 +1,155 @@
+#include "ModuleRegistry.h"
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+
+namespace AMM {
+    namespace {
+        ModuleRegistry::Prefix ToPrefix(const GuidPrefix_t &guidPrefix) {
+            ModuleRegistry::Prefix prefix;
+            std::memcpy(prefix.data(), guidPrefix.value, prefix.size());
+            return prefix;
+        }
+    }
+
+    std::size_t ModuleRegistry::PrefixHash::operator()(const Prefix &prefix) const {
+        // FNV-1a; prefixes differ mostly in their trailing host/process bytes.
+        uint64_t hash = 14695981039346656037ULL;
+        for (octet byte : prefix) {
+            hash ^= byte;
+            hash *= 1099511628211ULL;
+        }
+        return static_cast<std::size_t>(hash);
+    }
+
+    const ModuleRecord &ModuleRegistry::Resolve(const GUID_t &guid, bool *created) {
+        const Prefix prefix = ToPrefix(guid.guidPrefix);
+        if (created != nullptr) {
+            *created = false;
+        }
+
+        {
+            std::shared_lock<std::shared_timed_mutex> lock(m_mutex);
+            auto it = m_index.find(prefix);
+            if (it != m_index.end()) {
+                // Read first, so a busy module's entry is not written on every sample.
+                Entry &entry = *it->second;
+                if (!entry.used.load(std::memory_order_relaxed)) {
+                    entry.used.store(true, std::memory_order_relaxed);
+                }
+                return entry.record;
+            }
+        }
+
+        // First sight of this participant: format the GUID the way it has always
+        // been stored, i.e. the prefix part of "prefix|entity".
+        std::ostringstream module_guid;
+        module_guid << guid;
+        std::string guidString = module_guid.str();
+        guidString = guidString.substr(0, guidString.find("|"));
+
+        std::unique_lock<std::shared_timed_mutex> lock(m_mutex);
+        auto it = m_index.find(prefix);
+        if (it != m_index.end()) {
+            it->second->used.store(true, std::memory_order_relaxed);
+            return it->second->record;
+        }
+
+        std::unique_ptr<Entry> entry(new Entry());
+        ModuleRecord &record = entry->record;
+        auto tombstone = m_tombstones.find(prefix);
+        if (tombstone != m_tombstones.end()) {
+            // A module that was only quiet keeps its key and identity.
+            record.key = tombstone->second.key;
+            record.module_id = std::move(tombstone->second.module_id);
+            record.name = std::move(tombstone->second.name);
+            m_tombstones.erase(tombstone);
+        } else {
+            record.key = ++m_lastKey;
+        }
+        record.guid = std::move(guidString);
+        if (m_initializer) {
+            m_initializer(record);
+        }
+        m_index.emplace(prefix, std::move(entry));
+        if (created != nullptr) {
+            *created = true;
+        }
+        return record;
+    }
+
+    bool ModuleRegistry::Describe(const ModuleRecord &record, const std::string &moduleId, const std::string &name) {
+        std::unique_lock<std::shared_timed_mutex> lock(m_mutex);
+        if (record.module_id == moduleId && record.name == name) {
+            return false;
+        }
+        // Records are owned by m_index; callers only ever see them as const.
+        ModuleRecord &mutableRecord = const_cast<ModuleRecord &>(record);
+        mutableRecord.module_id = moduleId;
+        mutableRecord.name = name;
+        return true;
+    }
+
+    void ModuleRegistry::SetInitializer(std::function<void(ModuleRecord &)> initializer) {
+        std::unique_lock<std::shared_timed_mutex> lock(m_mutex);
+        m_initializer = std::move(initializer);
+    }
+
+    void ModuleRegistry::SetFinalizer(std::function<void(ModuleRecord &)> finalizer) {
+        std::unique_lock<std::shared_timed_mutex> lock(m_mutex);
+        m_finalizer = std::move(finalizer);
+    }
+
+    std::size_t ModuleRegistry::EvictIdle() {
+        std::vector<std::unique_ptr<Entry>> evicted;
+        std::function<void(ModuleRecord &)> finalizer;
+        {
+            std::unique_lock<std::shared_timed_mutex> lock(m_mutex);
+            for (auto it = m_index.begin(); it != m_index.end();) {
+                if (it->second->used.exchange(false, std::memory_order_relaxed)) {
+                    ++it;
+                } else {
+                    const ModuleRecord &record = it->second->record;
+                    m_tombstones[it->first] = Tombstone{record.key, record.module_id, record.name};
+                    evicted.push_back(std::move(it->second));
+                    it = m_index.erase(it);
+                }
+            }
+            finalizer = m_finalizer;
+        }
+        if (finalizer) {
+            for (const std::unique_ptr<Entry> &entry : evicted) {
+                finalizer(entry->record);
+            }
+        }
+        return evicted.size();
+    }
+
+    void ModuleRegistry::SetLastKey(uint32_t key) {
+        std::unique_lock<std::shared_timed_mutex> lock(m_mutex);
+        if (key > m_lastKey) {
+            m_lastKey = key;
+        }
+    }
+
+    void ModuleRegistry::ForEach(const std::function<void(const ModuleRecord &)> &visit) const {
+        std::shared_lock<std::shared_timed_mutex> lock(m_mutex);
+        std::vector<const ModuleRecord *> records;
+        records.reserve(m_index.size());
+        for (const auto &entry : m_index) {
+            records.push_back(&entry.second->record);
+        }
+        std::sort(records.begin(), records.end(), [](const ModuleRecord *a, const ModuleRecord *b) {
+            return a->key < b->key;
+        });
+        for (const ModuleRecord *record : records) {
+            visit(*record);
+        }
+    }
+
+    std::size_t ModuleRegistry::Size() const {
+        std::shared_lock<std::shared_timed_mutex> lock(m_mutex);
+        return m_index.size();
+    }
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "amm_std.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace AMM {
+
+    class Counter;
+
+/// Identity of a participant on the bus, keyed by the GuidPrefix its writers share.
+    struct ModuleRecord {
+        /// Small integer key used by downstream storage.
+        uint32_t key = 0;
+
+        /// String form of the GuidPrefix, as stored in module_guid/source columns.
+        std::string guid;
+
+        /// AMM module id and name, filled in once the module describes itself.
+        std::string module_id;
+        std::string name;
+
+        /// Per-module metrics, attached by the registry's initializer.
+        Counter *samples = nullptr;
+        Counter *bytes = nullptr;
+    };
+
+/// Caches GuidPrefix -> ModuleRecord so resolving a sample's writer is a single
+/// hash lookup on 12 bytes. Modules get a new GuidPrefix every time they restart, so
+/// records that resolve nothing for a whole EvictIdle() interval are dropped. A dropped
+/// record leaves a tombstone with its key and identity, so a module that was only quiet
+/// gets both back when it speaks again.
+    class ModuleRegistry {
+
+    public:
+        typedef std::array<octet, GuidPrefix_t::size> Prefix;
+
+        /// Returns the record for a writer, creating it on first sight or restoring it from its
+        /// tombstone after eviction; `created` is set in both cases.
+        const ModuleRecord &Resolve(const GUID_t &guid, bool *created = nullptr);
+
+        /// Records the module's self-reported identity. Returns true if it changed.
+        bool Describe(const ModuleRecord &record, const std::string &moduleId, const std::string &name);
+
+        /// Called once for every new record, before it becomes visible to other threads.
+        void SetInitializer(std::function<void(ModuleRecord &)> initializer);
+
+        /// Called for every evicted record, after it has become unreachable.
+        void SetFinalizer(std::function<void(ModuleRecord &)> finalizer);
+
+        /// Drops the records no sample resolved to since the previous call, keeping a tombstone
+        /// for each, and returns how many.
+        /// A reference from Resolve() is only good until the next call, so the interval must be
+        /// far longer than any listener callback.
+        std::size_t EvictIdle();
+
+        /// Keys are handed out sequentially starting after this value.
+        void SetLastKey(uint32_t key);
+
+        /// Calls `visit` for every record in key order. Runs under the registry's read lock, so the
+        /// records and their counters stay alive; `visit` must not call back into the registry.
+        void ForEach(const std::function<void(const ModuleRecord &)> &visit) const;
+
+        std::size_t Size() const;
+
+    private:
+        struct PrefixHash {
+            std::size_t operator()(const Prefix &prefix) const;
+        };
+
+        struct Entry {
+            ModuleRecord record;
+            /// Set by Resolve(), cleared by each EvictIdle() pass.
+            std::atomic<bool> used{true};
+        };
+
+        /// What an evicted record leaves behind: a fraction of its size, no metric series.
+        struct Tombstone {
+            uint32_t key;
+            std::string module_id;
+            std::string name;
+        };
+
+        mutable std::shared_timed_mutex m_mutex;
+        /// Entries are heap nodes, so evicting one leaves references to the others valid.
+        std::unordered_map<Prefix, std::unique_ptr<Entry>, PrefixHash> m_index;
+        std::unordered_map<Prefix, Tombstone, PrefixHash> m_tombstones;
+        uint32_t m_lastKey = 0;
+        std::function<void(ModuleRecord &)> m_initializer;
+        std::function<void(ModuleRecord &)> m_finalizer;
+    };
+
+} // namespace AMM
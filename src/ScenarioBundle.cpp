@@ -0,0 +1,310 @@
+#include "ScenarioBundle.h"
+
+#include "ScenarioCache.h"
+
+#include "plog/Log.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace AMM {
+    namespace {
+        const char Magic[8] = {'A', 'M', 'M', 'S', 'C', 'N', 'B', '\0'};
+        const uint32_t ByteOrder = 0x01020304;
+        const uint32_t Version = 1;
+
+        const uint32_t Required = 1;
+        const uint32_t Enabled = 2;
+
+        struct BundleString {
+            uint32_t offset;
+            uint32_t size;
+        };
+
+        struct BundleHeader {
+            char magic[8];
+            uint32_t byteOrder;
+            uint32_t version;
+            uint32_t scenarioCount;
+            uint32_t capabilityCount;
+            uint64_t stringsOffset;
+            uint64_t stringsSize;
+        };
+
+        struct BundleScenario {
+            BundleString name;
+            BundleString title;
+            BundleString metadata;
+            uint32_t firstCapability;
+            uint32_t capabilityCount;
+        };
+
+        struct BundleCapability {
+            BundleString name;
+            BundleString moduleName;
+            BundleString configuration;
+            uint32_t flags;
+        };
+
+        class StringTable {
+        public:
+            BundleString Add(const std::string &value) {
+                BundleString entry{static_cast<uint32_t>(m_data.size()), static_cast<uint32_t>(value.size())};
+                m_data.append(value);
+                m_data.push_back('\0');
+                return entry;
+            }
+
+            const std::string &Data() const { return m_data; }
+
+        private:
+            std::string m_data;
+        };
+
+        const BundleHeader &Header(const char *data) {
+            return *reinterpret_cast<const BundleHeader *>(data);
+        }
+
+        const BundleScenario *Scenarios(const char *data) {
+            return reinterpret_cast<const BundleScenario *>(data + sizeof(BundleHeader));
+        }
+
+        const BundleCapability *Capabilities(const char *data) {
+            return reinterpret_cast<const BundleCapability *>(
+                    data + sizeof(BundleHeader) + Header(data).scenarioCount * sizeof(BundleScenario));
+        }
+
+        std::string ReadString(const char *data, const BundleString &entry) {
+            return std::string(data + Header(data).stringsOffset + entry.offset, entry.size);
+        }
+
+        int CompareName(const char *data, const BundleString &entry, const std::string &name) {
+            const int order = std::memcmp(data + Header(data).stringsOffset + entry.offset, name.data(),
+                                          std::min<std::size_t>(entry.size, name.size()));
+            if (order != 0) {
+                return order;
+            }
+            return entry.size < name.size() ? -1 : entry.size > name.size() ? 1 : 0;
+        }
+    }
+
+    ScenarioBundle::~ScenarioBundle() {
+        Close();
+    }
+
+    bool ScenarioBundle::Write(const std::string &fileName,
+                               const std::vector<std::shared_ptr<const CompiledScenario>> &scenarios,
+                               std::string &error) {
+        typedef std::shared_ptr<const CompiledScenario> Entry;
+        std::vector<Entry> sorted(scenarios);
+        std::sort(sorted.begin(), sorted.end(), [](const Entry &a, const Entry &b) { return a->name < b->name; });
+
+        StringTable strings;
+        std::vector<BundleScenario> index;
+        std::vector<BundleCapability> capabilities;
+        for (const auto &scenario : sorted) {
+            BundleScenario entry{strings.Add(scenario->name), strings.Add(scenario->title),
+                                 strings.Add(scenario->metadata), static_cast<uint32_t>(capabilities.size()),
+                                 static_cast<uint32_t>(scenario->capabilities.size())};
+            index.push_back(entry);
+            for (const CompiledCapability &capability : scenario->capabilities) {
+                capabilities.push_back({strings.Add(capability.name), strings.Add(capability.moduleName),
+                                        strings.Add(capability.configuration),
+                                        (capability.required ? Required : 0) | (capability.enabled ? Enabled : 0)});
+            }
+        }
+
+        BundleHeader header;
+        std::memcpy(header.magic, Magic, sizeof(Magic));
+        header.byteOrder = ByteOrder;
+        header.version = Version;
+        header.scenarioCount = static_cast<uint32_t>(index.size());
+        header.capabilityCount = static_cast<uint32_t>(capabilities.size());
+        header.stringsOffset = sizeof(BundleHeader) + index.size() * sizeof(BundleScenario) +
+                               capabilities.size() * sizeof(BundleCapability);
+        header.stringsSize = strings.Data().size();
+
+        const std::string temporary = fileName + ".tmp";
+        {
+            std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+            out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+            out.write(reinterpret_cast<const char *>(index.data()), index.size() * sizeof(BundleScenario));
+            out.write(reinterpret_cast<const char *>(capabilities.data()),
+                      capabilities.size() * sizeof(BundleCapability));
+            out.write(strings.Data().data(), strings.Data().size());
+            if (!out.good()) {
+                error = "unable to write " + temporary;
+                return false;
+            }
+        }
+#ifdef _WIN32
+        // rename cannot replace an existing file here; elsewhere it swaps the bundle atomically.
+        std::remove(fileName.c_str());
+#endif
+        if (std::rename(temporary.c_str(), fileName.c_str()) != 0) {
+            error = "unable to rename " + temporary + " to " + fileName;
+            return false;
+        }
+        return true;
+    }
+
+    bool ScenarioBundle::Open(const std::string &fileName) {
+        Close();
+#ifdef _WIN32
+        std::ifstream in(fileName, std::ios::binary);
+        if (!in) {
+            LOG_ERROR << "Unable to open scenario bundle " << fileName;
+            return false;
+        }
+        std::ostringstream contents;
+        contents << in.rdbuf();
+        m_buffer = contents.str();
+        m_data = m_buffer.data();
+        m_size = m_buffer.size();
+#else
+        const int fd = open(fileName.c_str(), O_RDONLY | O_CLOEXEC);
+        struct stat info;
+        if (fd < 0 || fstat(fd, &info) != 0) {
+            LOG_ERROR << "Unable to open scenario bundle " << fileName << ": " << strerror(errno);
+            if (fd >= 0) {
+                close(fd);
+            }
+            return false;
+        }
+        m_size = static_cast<std::size_t>(info.st_size);
+        void *mapping = m_size == 0 ? MAP_FAILED : mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (mapping == MAP_FAILED) {
+            LOG_ERROR << "Unable to map scenario bundle " << fileName << ": " << strerror(errno);
+            m_size = 0;
+            return false;
+        }
+        m_data = static_cast<const char *>(mapping);
+        m_mapped = true;
+#endif
+        std::string error;
+        if (!Validate(error)) {
+            LOG_ERROR << "Scenario bundle " << fileName << " is unusable: " << error;
+            Close();
+            return false;
+        }
+        return true;
+    }
+
+    void ScenarioBundle::Close() {
+#ifndef _WIN32
+        if (m_mapped) {
+            munmap(const_cast<char *>(m_data), m_size);
+        }
+#endif
+        m_mapped = false;
+        m_data = nullptr;
+        m_size = 0;
+        m_buffer.clear();
+    }
+
+    bool ScenarioBundle::Validate(std::string &error) const {
+        if (m_size < sizeof(BundleHeader) || std::memcmp(Header(m_data).magic, Magic, sizeof(Magic)) != 0) {
+            error = "not a scenario bundle";
+            return false;
+        }
+        const BundleHeader &header = Header(m_data);
+        if (header.byteOrder != ByteOrder || header.version != Version) {
+            error = "built for another byte order or format version";
+            return false;
+        }
+        const uint64_t tables = sizeof(BundleHeader) + uint64_t(header.scenarioCount) * sizeof(BundleScenario) +
+                                uint64_t(header.capabilityCount) * sizeof(BundleCapability);
+        // Compared without adding, so offsets near 2^64 cannot wrap around to the file size.
+        if (header.stringsOffset != tables || header.stringsOffset > m_size ||
+            header.stringsSize != m_size - header.stringsOffset) {
+            error = "truncated or padded";
+            return false;
+        }
+
+        const char *strings = m_data + header.stringsOffset;
+        auto valid = [&](const BundleString &entry) {
+            return uint64_t(entry.offset) + entry.size < header.stringsSize &&
+                   strings[entry.offset + entry.size] == '\0';
+        };
+        const BundleScenario *scenarios = Scenarios(m_data);
+        for (uint32_t i = 0; i < header.scenarioCount; ++i) {
+            const BundleScenario &scenario = scenarios[i];
+            if (!valid(scenario.name) || !valid(scenario.title) || !valid(scenario.metadata) ||
+                uint64_t(scenario.firstCapability) + scenario.capabilityCount > header.capabilityCount) {
+                error = "scenario " + std::to_string(i) + " is out of bounds";
+                return false;
+            }
+            if (i > 0 && CompareName(m_data, scenarios[i - 1].name, ReadString(m_data, scenario.name)) >= 0) {
+                error = "scenario index is not sorted";
+                return false;
+            }
+        }
+        const BundleCapability *capabilities = Capabilities(m_data);
+        for (uint32_t i = 0; i < header.capabilityCount; ++i) {
+            const BundleCapability &capability = capabilities[i];
+            if (!valid(capability.name) || !valid(capability.moduleName) || !valid(capability.configuration)) {
+                error = "capability " + std::to_string(i) + " is out of bounds";
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::size_t ScenarioBundle::Size() const {
+        return m_data == nullptr ? 0 : Header(m_data).scenarioCount;
+    }
+
+    std::vector<std::string> ScenarioBundle::Names() const {
+        std::vector<std::string> names;
+        const BundleScenario *scenarios = m_data == nullptr ? nullptr : Scenarios(m_data);
+        for (std::size_t i = 0; i < Size(); ++i) {
+            names.push_back(ReadString(m_data, scenarios[i].name));
+        }
+        return names;
+    }
+
+    std::shared_ptr<CompiledScenario> ScenarioBundle::Find(const std::string &name) const {
+        if (m_data == nullptr) {
+            return nullptr;
+        }
+        const BundleScenario *first = Scenarios(m_data);
+        const BundleScenario *last = first + Header(m_data).scenarioCount;
+        const BundleScenario *entry = std::lower_bound(first, last, name,
+                                                       [this](const BundleScenario &scenario, const std::string &key) {
+                                                           return CompareName(m_data, scenario.name, key) < 0;
+                                                       });
+        if (entry == last || CompareName(m_data, entry->name, name) != 0) {
+            return nullptr;
+        }
+
+        std::shared_ptr<CompiledScenario> scenario = std::make_shared<CompiledScenario>();
+        scenario->name = name;
+        scenario->title = ReadString(m_data, entry->title);
+        scenario->metadata = ReadString(m_data, entry->metadata);
+        const BundleCapability *capabilities = Capabilities(m_data) + entry->firstCapability;
+        scenario->capabilities.resize(entry->capabilityCount);
+        for (uint32_t i = 0; i < entry->capabilityCount; ++i) {
+            CompiledCapability &capability = scenario->capabilities[i];
+            capability.name = ReadString(m_data, capabilities[i].name);
+            capability.moduleName = ReadString(m_data, capabilities[i].moduleName);
+            capability.configuration = ReadString(m_data, capabilities[i].configuration);
+            capability.required = (capabilities[i].flags & Required) != 0;
+            capability.enabled = (capabilities[i].flags & Enabled) != 0;
+        }
+        return scenario;
+    }
+
+} // namespace AMM
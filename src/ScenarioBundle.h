@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace AMM {
+
+    struct CompiledScenario;
+
+/// Compiled scenarios in one file, built by amm_scenario_compiler and memory-mapped by
+/// the manager so no XML is parsed at startup. The file is a header, a scenario index
+/// sorted by name, a capability table, then the NUL-terminated strings both refer to.
+    class ScenarioBundle {
+
+    public:
+        ScenarioBundle() = default;
+
+        ScenarioBundle(const ScenarioBundle &) = delete;
+
+        ScenarioBundle &operator=(const ScenarioBundle &) = delete;
+
+        ~ScenarioBundle();
+
+        /// Writes scenarios to a bundle, replacing `fileName` only once it is complete.
+        static bool Write(const std::string &fileName,
+                          const std::vector<std::shared_ptr<const CompiledScenario>> &scenarios, std::string &error);
+
+        /// Maps a bundle and checks that every offset in it is in bounds.
+        bool Open(const std::string &fileName);
+
+        void Close();
+
+        bool IsOpen() const { return m_data != nullptr; }
+
+        std::size_t Size() const;
+
+        std::vector<std::string> Names() const;
+
+        /// Copies the named scenario out of the bundle. Null if it is not there.
+        std::shared_ptr<CompiledScenario> Find(const std::string &name) const;
+
+    private:
+        bool Validate(std::string &error) const;
+
+        const char *m_data = nullptr;
+        std::size_t m_size = 0;
+
+        /// Holds the file where it cannot be mapped.
+        std::string m_buffer;
+        bool m_mapped = false;
+    };
+
+} // namespace AMM
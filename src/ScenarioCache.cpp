@@ -0,0 +1,334 @@
+#include "ScenarioCache.h"
+
+#include "ScenarioParser.h"
+#include "ThreadPlacement.h"
+#include "Tracer.h"
+
+#include "plog/Log.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <dirent.h>
+#endif
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace AMM {
+    namespace {
+        const std::string Extension = ".xml";
+
+        bool EndsWith(const std::string &value, const std::string &suffix) {
+            return value.size() > suffix.size() &&
+                   value.compare(value.size() - suffix.size(), suffix.size(), suffix) == 0;
+        }
+    }
+
+    std::vector<std::string> ScenarioCache::List(const std::string &directory) {
+        std::vector<std::string> names;
+#ifdef _WIN32
+        _finddata_t entry;
+        intptr_t handle = _findfirst((directory + "/*" + Extension).c_str(), &entry);
+        if (handle == -1) {
+            return names;
+        }
+        do {
+            names.push_back(std::string(entry.name, strlen(entry.name) - Extension.size()));
+        } while (_findnext(handle, &entry) == 0);
+        _findclose(handle);
+#else
+        DIR *dir = opendir(directory.c_str());
+        if (dir == nullptr) {
+            return names;
+        }
+        while (dirent *entry = readdir(dir)) {
+            const std::string file = entry->d_name;
+            if (EndsWith(file, Extension)) {
+                names.push_back(file.substr(0, file.size() - Extension.size()));
+            }
+        }
+        closedir(dir);
+#endif
+        return names;
+    }
+
+    ScenarioCache::ScenarioCache(std::string directory) : m_directory(std::move(directory)) {}
+
+    ScenarioCache::~ScenarioCache() {
+        StopWatching();
+    }
+
+    std::size_t ScenarioCache::Preload() {
+        TraceSpan span("PreloadScenarios", "scenario");
+        struct stat info;
+        if (stat(BundleFile().c_str(), &info) == 0 && m_bundle.Open(BundleFile())) {
+            // Files edited while the manager was stopped would otherwise be served from the stale
+            // bundle. Same-second timestamps are ambiguous, so those count as newer too.
+            const std::vector<std::string> bundled = m_bundle.Names();
+            std::map<std::string, std::shared_ptr<const CompiledScenario>> newer;
+            for (const std::string &name : List(m_directory)) {
+                const std::string file = m_directory + "/" + name + Extension;
+                const bool inBundle = std::binary_search(bundled.begin(), bundled.end(), name);
+                struct stat source;
+                if (inBundle && (stat(file.c_str(), &source) != 0 || source.st_mtime < info.st_mtime)) {
+                    continue;
+                }
+                LOG_WARNING << file << (inBundle ? " is newer than " : " is not in ") << BundleFile()
+                            << ", loading it from XML; re-run amm_scenario_compiler.";
+                std::shared_ptr<CompiledScenario> scenario = Compile(file, name);
+                if (scenario) {
+                    newer[name] = std::move(scenario);
+                }
+            }
+
+            const std::size_t fromXml = newer.size();
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_scenarios.swap(newer);
+            }
+            LOG_INFO << "Mapped " << m_bundle.Size() << " scenarios from " << BundleFile() << ", " << fromXml
+                     << " from XML files newer than it.";
+            return Names().size();
+        }
+
+        std::map<std::string, std::shared_ptr<const CompiledScenario>> scenarios;
+        for (const std::string &name : List(m_directory)) {
+            std::shared_ptr<CompiledScenario> scenario = Compile(m_directory + "/" + name + Extension, name);
+            if (scenario) {
+                scenarios[name] = std::move(scenario);
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_scenarios.swap(scenarios);
+        LOG_INFO << "Cached " << m_scenarios.size() << " scenarios from " << m_directory;
+        return m_scenarios.size();
+    }
+
+    std::shared_ptr<const CompiledScenario> ScenarioCache::Find(const std::string &name) {
+        bool removed;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto it = m_scenarios.find(name);
+            if (it != m_scenarios.end()) {
+                return it->second;
+            }
+            removed = m_removed.count(name) != 0;
+        }
+
+        std::shared_ptr<const CompiledScenario> bundled = removed ? nullptr : m_bundle.Find(name);
+        if (bundled) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            // A reload may have raced us; what it compiled from XML is newer than the bundle.
+            return m_scenarios.emplace(name, std::move(bundled)).first->second;
+        }
+
+        // Not there at startup, or it failed to parse then; the file may have been fixed since.
+        LOG_INFO << "Scenario " << name << " is not cached, loading it from " << m_directory;
+        std::shared_ptr<const CompiledScenario> scenario = Compile(m_directory + "/" + name + Extension, name);
+        if (scenario) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_scenarios[name] = scenario;
+            m_removed.erase(name);
+        }
+        return scenario;
+    }
+
+    std::vector<std::string> ScenarioCache::Names() const {
+        std::vector<std::string> names = m_bundle.Names();
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            names.erase(std::remove_if(names.begin(), names.end(), [this](const std::string &name) {
+                return m_removed.count(name) != 0;
+            }), names.end());
+            for (const auto &scenario : m_scenarios) {
+                names.push_back(scenario.first);
+            }
+        }
+        std::sort(names.begin(), names.end());
+        names.erase(std::unique(names.begin(), names.end()), names.end());
+        return names;
+    }
+
+    bool ScenarioCache::Watch(std::chrono::milliseconds settle) {
+#ifdef __linux__
+        if (m_watcher.joinable()) {
+            return true;
+        }
+        struct stat info;
+        if (stat(m_directory.c_str(), &info) != 0) {
+            LOG_INFO << "There is no " << m_directory << " to watch for scenario changes.";
+            return false;
+        }
+        m_notifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        m_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        // Editors that save by renaming a temporary file over the original produce IN_MOVED_TO.
+        if (m_notifyFd < 0 || m_wakeFd < 0 ||
+            inotify_add_watch(m_notifyFd, m_directory.c_str(),
+                              IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE) < 0) {
+            LOG_ERROR << "Unable to watch " << m_directory << ": " << strerror(errno);
+            StopWatching();
+            return false;
+        }
+        m_watcher = std::thread(&ScenarioCache::WatchLoop, this, settle);
+        LOG_INFO << "Watching " << m_directory << " for scenario changes.";
+        return true;
+#else
+        LOG_WARNING << "Scenario hot reload is not available on this platform.";
+        return false;
+#endif
+    }
+
+    void ScenarioCache::StopWatching() {
+#ifdef __linux__
+        if (m_watcher.joinable()) {
+            const uint64_t one = 1;
+            if (write(m_wakeFd, &one, sizeof(one)) < 0) {
+                LOG_ERROR << "Unable to stop the scenario watcher: " << strerror(errno);
+            }
+            m_watcher.join();
+        }
+        if (m_notifyFd >= 0) {
+            close(m_notifyFd);
+            m_notifyFd = -1;
+        }
+        if (m_wakeFd >= 0) {
+            close(m_wakeFd);
+            m_wakeFd = -1;
+        }
+#endif
+    }
+
+    void ScenarioCache::WatchLoop(std::chrono::milliseconds settle) {
+#ifdef __linux__
+        ThreadPlacement::Apply(ThreadRole::Maintenance, "scenario-watch");
+        std::set<std::string> changed;
+        bool overflowed = false;
+        auto lastChange = std::chrono::steady_clock::now();
+        alignas(inotify_event) char buffer[4096];
+
+        for (;;) {
+            int timeout = -1;
+            if (!changed.empty() || overflowed) {
+                const auto quiet = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        std::chrono::steady_clock::now() - lastChange);
+                timeout = static_cast<int>(std::max<int64_t>(0, (settle - quiet).count()));
+            }
+
+            pollfd fds[2] = {{m_notifyFd, POLLIN, 0}, {m_wakeFd, POLLIN, 0}};
+            if (poll(fds, 2, timeout) < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                LOG_ERROR << "Scenario watcher stopped: " << strerror(errno);
+                return;
+            }
+            if (fds[1].revents != 0) {
+                return;
+            }
+
+            if (fds[0].revents != 0) {
+                ssize_t length;
+                while ((length = read(m_notifyFd, buffer, sizeof(buffer))) > 0) {
+                    for (char *p = buffer; p < buffer + length;) {
+                        const inotify_event *event = reinterpret_cast<const inotify_event *>(p);
+                        p += sizeof(inotify_event) + event->len;
+                        if (event->mask & IN_Q_OVERFLOW) {
+                            overflowed = true;
+                            continue;
+                        }
+                        const std::string file = event->len > 0 ? event->name : "";
+                        if (EndsWith(file, Extension)) {
+                            changed.insert(file.substr(0, file.size() - Extension.size()));
+                        }
+                    }
+                }
+                lastChange = std::chrono::steady_clock::now();
+                continue;
+            }
+
+            // Quiet for a whole settle period: an editor's burst of writes is over.
+            if (overflowed) {
+                LOG_WARNING << "Missed scenario changes in " << m_directory << ", reloading all of them.";
+                changed.clear();
+                for (const std::string &name : List(m_directory)) {
+                    changed.insert(name);
+                }
+                for (const std::string &name : Names()) {
+                    changed.insert(name);
+                }
+                overflowed = false;
+            }
+            Reload(changed);
+            changed.clear();
+        }
+#endif
+    }
+
+    void ScenarioCache::Reload(const std::set<std::string> &names) {
+        const std::vector<std::string> bundled = m_bundle.Names();
+        for (const std::string &name : names) {
+            const std::string fileName = m_directory + "/" + name + Extension;
+            struct stat info;
+            if (stat(fileName.c_str(), &info) != 0) {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                const bool cached = m_scenarios.erase(name) > 0;
+                // The bundle still has it, so remember the deletion rather than fall back to it.
+                const bool hidden = std::binary_search(bundled.begin(), bundled.end(), name) &&
+                                    m_removed.insert(name).second;
+                if (cached || hidden) {
+                    LOG_INFO << "Scenario " << name << " was removed from " << m_directory;
+                }
+                continue;
+            }
+            std::shared_ptr<const CompiledScenario> scenario = Compile(fileName, name);
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!scenario) {
+                if (m_scenarios.count(name) > 0) {
+                    LOG_ERROR << "Scenario " << name << " failed to reload; keeping the last good version.";
+                }
+                continue;
+            }
+            m_scenarios[name] = std::move(scenario);
+            m_removed.erase(name);
+            LOG_INFO << "Reloaded scenario " << name;
+        }
+    }
+
+    std::shared_ptr<CompiledScenario> ScenarioCache::Compile(const std::string &fileName, const std::string &name,
+                                                             std::vector<std::string> *problems) {
+        TraceSpan span("CompileScenario", "scenario");
+        std::ifstream in(fileName, std::ios::binary);
+        if (!in) {
+            LOG_ERROR << "Unable to open scenario " << fileName;
+            return nullptr;
+        }
+        std::string error;
+        std::vector<std::string> found;
+        std::shared_ptr<CompiledScenario> scenario = ScenarioParser::Parse(in, name, error, found);
+        if (!scenario) {
+            LOG_ERROR << "Unable to load scenario " << fileName << ": " << error;
+            return nullptr;
+        }
+        for (std::string &problem : found) {
+            LOG_WARNING << fileName << ": " << problem;
+            if (problems != nullptr) {
+                problems->push_back(std::move(problem));
+            }
+        }
+        return scenario;
+    }
+
+} // namespace AMM
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "ScenarioBundle.h"
+
+#include <chrono>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace AMM {
+
+/// One <capability> of a scenario, ready to publish as a ModuleConfiguration.
+    struct CompiledCapability {
+        std::string name;
+
+        /// module_name attribute; empty when the capability applies to any module.
+        std::string moduleName;
+
+        bool required = false;
+        bool enabled = true;
+
+        /// The whole <capability> element as printed XML; empty when it has no
+        /// <configuration_data>, in which case nothing is published for it.
+        std::string configuration;
+    };
+
+/// A scenario file reduced to the payloads a LOAD_SCENARIO publishes.
+    struct CompiledScenario {
+        /// File name without directory or extension: the name LOAD_SCENARIO uses.
+        std::string name;
+
+        /// name attribute of the <Scenario> element.
+        std::string title;
+
+        /// The <metadata> element as printed XML; empty when there is none.
+        std::string metadata;
+
+        std::vector<CompiledCapability> capabilities;
+    };
+
+/// Scenarios parsed once and kept in memory, so loading one is only publishing.
+/// Compiled scenarios are immutable and shared; lookups are safe from any thread.
+/// While watching, files that change are recompiled in the background and swapped in.
+    class ScenarioCache {
+
+    public:
+        explicit ScenarioCache(std::string directory = "static/scenarios");
+
+        ~ScenarioCache();
+
+        /// Maps the directory's bundle (static/scenarios.bundle for static/scenarios) if there
+        /// is one, compiling only the .xml files it lacks or that are newer than it; otherwise
+        /// compiles every .xml file in the directory, replacing what was cached. Returns the
+        /// number of scenarios available.
+        std::size_t Preload();
+
+        /// The named scenario: as compiled or reloaded from XML, else from the bundle unless its
+        /// file was deleted while watching, else compiled and cached from disk. Null if there is
+        /// no such file or it does not parse.
+        std::shared_ptr<const CompiledScenario> Find(const std::string &name);
+
+        std::vector<std::string> Names() const;
+
+        /// Recompiles files once they have been quiet for `settle` after a change. A file
+        /// that no longer parses keeps its last good version; a deleted one is dropped.
+        /// Returns false where change notification is unavailable.
+        bool Watch(std::chrono::milliseconds settle = std::chrono::milliseconds(200));
+
+        void StopWatching();
+
+        const std::string &Directory() const { return m_directory; }
+
+        std::string BundleFile() const { return m_directory + ".bundle"; }
+
+        /// Names of the .xml files in a directory, without the extension.
+        static std::vector<std::string> List(const std::string &directory);
+
+        /// Parses one scenario file. Null, with the reason logged, if it cannot be used.
+        /// Anything the manager tolerates but a scenario author should fix, such as an
+        /// unnamed or duplicate capability, is appended to `problems` when given.
+        static std::shared_ptr<CompiledScenario> Compile(const std::string &fileName, const std::string &name,
+                                                         std::vector<std::string> *problems = nullptr);
+
+    private:
+        void WatchLoop(std::chrono::milliseconds settle);
+
+        /// Recompiles the named scenarios, replacing or dropping each cached one.
+        void Reload(const std::set<std::string> &names);
+
+        std::string m_directory;
+
+        /// inotify descriptor for the directory, and an eventfd that stops the watcher.
+        int m_notifyFd = -1;
+        int m_wakeFd = -1;
+        std::thread m_watcher;
+
+        /// Mapped once by Preload and read-only afterwards.
+        ScenarioBundle m_bundle;
+
+        mutable std::mutex m_mutex;
+        std::map<std::string, std::shared_ptr<const CompiledScenario>> m_scenarios;
+
+        /// Scenarios whose file was deleted while watching, hidden from the bundle until it compiles again.
+        std::set<std::string> m_removed;
+    };
+
+} // namespace AMM
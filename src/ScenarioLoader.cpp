@@ -0,0 +1,104 @@
+#include "ScenarioLoader.h"
+
+#include "ThreadPlacement.h"
+
+#include "plog/Log.h"
+
+namespace AMM {
+    ScenarioLoader::ScenarioLoader(Load load) : m_load(std::move(load)) {}
+
+    ScenarioLoader::~ScenarioLoader() {
+        Stop();
+    }
+
+    void ScenarioLoader::Start() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_running) {
+            return;
+        }
+        m_running = true;
+        m_thread = std::thread(&ScenarioLoader::Run, this);
+    }
+
+    void ScenarioLoader::Stop() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_running) {
+                return;
+            }
+            m_running = false;
+            m_order.clear();
+            m_waiting.clear();
+        }
+        m_cv.notify_one();
+        if (m_thread.joinable()) {
+            m_thread.join();
+        }
+    }
+
+    void ScenarioLoader::Submit(const std::string &key, const std::string &request) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_running) {
+                LOG_WARNING << "Scenario loader is stopped, ignoring " << request;
+                return;
+            }
+            auto waiting = m_waiting.find(key);
+            if (waiting != m_waiting.end()) {
+                LOG_INFO << "Load of " << waiting->second << " was replaced by " << request << " before it started.";
+                m_superseded.fetch_add(1, std::memory_order_relaxed);
+                waiting->second = request;
+            } else {
+                m_order.push_back(key);
+                m_waiting.emplace(key, request);
+            }
+            ++m_generations[key];
+        }
+        m_cv.notify_one();
+    }
+
+    bool ScenarioLoader::Outdated(const std::string &key, uint64_t generation) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return !m_running || m_generations[key] != generation;
+    }
+
+    void ScenarioLoader::Run() {
+        ThreadPlacement::Apply(ThreadRole::Maintenance, "scenario-load");
+        for (;;) {
+            std::string key;
+            std::string request;
+            uint64_t generation;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_cv.wait(lock, [this] { return !m_order.empty() || !m_running; });
+                if (!m_running) {
+                    return;
+                }
+                key = m_order.front();
+                m_order.pop_front();
+                auto waiting = m_waiting.find(key);
+                request.swap(waiting->second);
+                m_waiting.erase(waiting);
+                generation = m_generations[key];
+            }
+
+            bool reported = false;
+            const Cancelled cancelled = [this, &key, generation, &reported] {
+                if (!Outdated(key, generation)) {
+                    return false;
+                }
+                if (!reported) {
+                    m_superseded.fetch_add(1, std::memory_order_relaxed);
+                    reported = true;
+                }
+                return true;
+            };
+            try {
+                m_load(request, cancelled);
+            } catch (std::exception &e) {
+                LOG_ERROR << "Loading " << request << " failed: " << e.what();
+            }
+        }
+    }
+
+} // namespace AMM
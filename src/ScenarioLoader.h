@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace AMM {
+
+/// Runs scenario loads one at a time on its own thread, so the Command listener only
+/// hands them off. Loads are keyed by the manikin they configure, and only the newest
+/// request per manikin matters: submitting cancels that manikin's load in progress at its
+/// next step and replaces its request still waiting. Other manikins' loads run in turn.
+    class ScenarioLoader {
+
+    public:
+        /// True once the load it was passed to has been superseded or the loader is stopping.
+        typedef std::function<bool()> Cancelled;
+
+        /// Performs one load, checking `cancelled` between steps.
+        typedef std::function<void(const std::string &request, const Cancelled &cancelled)> Load;
+
+        explicit ScenarioLoader(Load load);
+
+        ~ScenarioLoader();
+
+        ScenarioLoader(const ScenarioLoader &) = delete;
+
+        ScenarioLoader &operator=(const ScenarioLoader &) = delete;
+
+        void Start();
+
+        /// Cancels the running load, drops a waiting one and joins the thread.
+        void Stop();
+
+        /// Queues a load for manikin `key` (empty when the request names none). Ignored once the
+        /// loader has stopped.
+        void Submit(const std::string &key, const std::string &request);
+
+        /// Requests cancelled before or while they ran.
+        uint64_t Superseded() const { return m_superseded.load(std::memory_order_relaxed); }
+
+    private:
+        void Run();
+
+        /// True once `key` has moved past `generation` or the loader is stopping.
+        bool Outdated(const std::string &key, uint64_t generation);
+
+        Load m_load;
+
+        std::mutex m_mutex;
+        std::condition_variable m_cv;
+        bool m_running = false;
+        /// Manikins with a request waiting, in the order they first asked.
+        std::deque<std::string> m_order;
+        std::map<std::string, std::string> m_waiting;
+
+        /// Bumped by every submission for a manikin; a load runs only while it holds the latest value.
+        std::map<std::string, uint64_t> m_generations;
+        std::atomic<uint64_t> m_superseded{0};
+
+        std::thread m_thread;
+    };
+
+} // namespace AMM
@@ -0,0 +1,475 @@
+#include "ScenarioParser.h"
+
+#include "ScenarioCache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+namespace AMM {
+    namespace {
+        bool IsSpace(char c) {
+            return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+        }
+
+        void AppendUtf8(std::string &out, unsigned long code) {
+            if (code < 0x80) {
+                out += static_cast<char>(code);
+            } else if (code < 0x800) {
+                out += static_cast<char>(0xC0 | (code >> 6));
+                out += static_cast<char>(0x80 | (code & 0x3F));
+            } else if (code < 0x10000) {
+                out += static_cast<char>(0xE0 | (code >> 12));
+                out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (code & 0x3F));
+            } else {
+                out += static_cast<char>(0xF0 | (code >> 18));
+                out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+                out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (code & 0x3F));
+            }
+        }
+
+        /// Replaces the predefined and numeric character references; others are kept as written.
+        std::string DecodeEntities(const std::string &value) {
+            std::string out;
+            out.reserve(value.size());
+            for (std::size_t i = 0; i < value.size(); ++i) {
+                const std::size_t end = value[i] == '&' ? value.find(';', i) : std::string::npos;
+                if (end == std::string::npos) {
+                    out += value[i];
+                    continue;
+                }
+                const std::string entity = value.substr(i + 1, end - i - 1);
+                if (entity == "amp") {
+                    out += '&';
+                } else if (entity == "lt") {
+                    out += '<';
+                } else if (entity == "gt") {
+                    out += '>';
+                } else if (entity == "quot") {
+                    out += '"';
+                } else if (entity == "apos") {
+                    out += '\'';
+                } else if (entity.size() > 1 && entity[0] == '#') {
+                    const bool hex = entity[1] == 'x';
+                    AppendUtf8(out, std::strtoul(entity.c_str() + (hex ? 2 : 1), nullptr, hex ? 16 : 10));
+                } else {
+                    out += value.substr(i, end - i + 1);
+                }
+                i = end;
+            }
+            return out;
+        }
+
+/// Pull scanner over an XML stream. Text, comments, CDATA, processing instructions and
+/// DOCTYPE declarations are skipped without being buffered; tags are returned one at a time.
+        class XmlScanner {
+
+        public:
+            enum Token { StartTag, EndTag, EmptyTag, End, Failed };
+
+            explicit XmlScanner(std::istream &in) : m_in(in) {}
+
+            Token Next();
+
+            const std::string &Name() const { return m_name; }
+
+            const std::string *Attribute(const char *name) const {
+                for (const auto &attribute : m_attributes) {
+                    if (attribute.first == name) {
+                        return &attribute.second;
+                    }
+                }
+                return nullptr;
+            }
+
+            /// Copies the document into `out` from the start of the tag just read.
+            void Capture(std::string *out) {
+                m_capture = out;
+                if (out != nullptr) {
+                    out->append(m_tag);
+                }
+            }
+
+            const std::string &Error() const { return m_error; }
+
+            std::size_t Line() const { return m_line; }
+
+        private:
+            /// Reads until `count` unconsumed bytes are buffered; false at end of file.
+            bool Ensure(std::size_t count);
+
+            void Consume(std::size_t count);
+
+            /// Consumes through the next occurrence of `terminator`, keeping at most a chunk.
+            bool SkipPast(const char *terminator);
+
+            bool StartsWith(const char *prefix) {
+                const std::size_t length = std::strlen(prefix);
+                return Ensure(length) && m_buffer.compare(m_pos, length, prefix) == 0;
+            }
+
+            Token ReadTag();
+
+            bool ParseTag();
+
+            Token Fail(const std::string &error) {
+                m_error = error;
+                return Failed;
+            }
+
+            std::istream &m_in;
+            std::string m_buffer;
+            std::size_t m_pos = 0;
+            bool m_eof = false;
+            std::size_t m_line = 1;
+
+            std::string *m_capture = nullptr;
+
+            /// The last tag as written, and its parts.
+            std::string m_tag;
+            std::string m_name;
+            std::vector<std::pair<std::string, std::string>> m_attributes;
+
+            std::string m_error;
+        };
+
+        bool XmlScanner::Ensure(std::size_t count) {
+            while (m_buffer.size() - m_pos < count && !m_eof) {
+                m_buffer.erase(0, m_pos);
+                m_pos = 0;
+                const std::size_t used = m_buffer.size();
+                m_buffer.resize(used + ScenarioParser::ChunkSize);
+                m_in.read(&m_buffer[used], ScenarioParser::ChunkSize);
+                const std::size_t read = static_cast<std::size_t>(m_in.gcount());
+                m_buffer.resize(used + read);
+                m_eof = read == 0;
+            }
+            return m_buffer.size() - m_pos >= count;
+        }
+
+        void XmlScanner::Consume(std::size_t count) {
+            const char *data = m_buffer.data() + m_pos;
+            m_line += std::count(data, data + count, '\n');
+            if (m_capture != nullptr) {
+                m_capture->append(data, count);
+            }
+            m_pos += count;
+        }
+
+        bool XmlScanner::SkipPast(const char *terminator) {
+            const std::size_t length = std::strlen(terminator);
+            for (;;) {
+                const char *data = m_buffer.data() + m_pos;
+                const char *end = data + (m_buffer.size() - m_pos);
+                const char *found = std::search(data, end, terminator, terminator + length);
+                if (found != end) {
+                    Consume(found - data + length);
+                    return true;
+                }
+                // Keep a tail that may be the start of the terminator.
+                const std::size_t available = end - data;
+                if (available >= length) {
+                    Consume(available - (length - 1));
+                }
+                if (!Ensure(m_buffer.size() - m_pos + 1)) {
+                    return false;
+                }
+            }
+        }
+
+        XmlScanner::Token XmlScanner::Next() {
+            m_tag.clear();
+            m_name.clear();
+            m_attributes.clear();
+            for (;;) {
+                if (!Ensure(1)) {
+                    return End;
+                }
+                if (m_buffer[m_pos] != '<') {
+                    const char *data = m_buffer.data() + m_pos;
+                    const void *next = std::memchr(data, '<', m_buffer.size() - m_pos);
+                    Consume(next == nullptr ? m_buffer.size() - m_pos : static_cast<const char *>(next) - data);
+                    continue;
+                }
+                if (StartsWith("<!--")) {
+                    Consume(4);
+                    if (!SkipPast("-->")) {
+                        return Fail("unterminated comment");
+                    }
+                } else if (StartsWith("<![CDATA[")) {
+                    Consume(9);
+                    if (!SkipPast("]]>")) {
+                        return Fail("unterminated CDATA section");
+                    }
+                } else if (StartsWith("<?")) {
+                    Consume(2);
+                    if (!SkipPast("?>")) {
+                        return Fail("unterminated processing instruction");
+                    }
+                } else if (StartsWith("<!")) {
+                    Consume(2);
+                    if (!SkipPast(">")) {
+                        return Fail("unterminated declaration");
+                    }
+                } else {
+                    return ReadTag();
+                }
+            }
+        }
+
+        XmlScanner::Token XmlScanner::ReadTag() {
+            std::size_t length = 1;
+            char quote = 0;
+            for (;;) {
+                const char *data = m_buffer.data() + m_pos;
+                const std::size_t available = m_buffer.size() - m_pos;
+                for (; length < available; ++length) {
+                    const char c = data[length];
+                    if (quote != 0) {
+                        quote = c == quote ? 0 : quote;
+                    } else if (c == '"' || c == '\'') {
+                        quote = c;
+                    } else if (c == '>') {
+                        break;
+                    }
+                }
+                if (length >= ScenarioParser::MaxTagSize) {
+                    return Fail("tag longer than " + std::to_string(ScenarioParser::MaxTagSize) + " bytes");
+                }
+                if (length < available) {
+                    break;
+                }
+                if (!Ensure(available + 1)) {
+                    return Fail("unterminated tag");
+                }
+            }
+            m_tag.assign(m_buffer, m_pos, length + 1);
+            const std::size_t line = m_line;
+            Consume(length + 1);
+            if (!ParseTag()) {
+                m_line = line;
+                return Failed;
+            }
+            if (m_tag[1] == '/') {
+                return EndTag;
+            }
+            return m_tag[m_tag.size() - 2] == '/' ? EmptyTag : StartTag;
+        }
+
+        bool XmlScanner::ParseTag() {
+            const bool end = m_tag[1] == '/';
+            const bool empty = !end && m_tag[m_tag.size() - 2] == '/';
+            std::size_t i = end ? 2 : 1;
+            const std::size_t last = m_tag.size() - (empty ? 2 : 1);
+
+            const std::size_t nameStart = i;
+            while (i < last && !IsSpace(m_tag[i])) {
+                ++i;
+            }
+            m_name = m_tag.substr(nameStart, i - nameStart);
+            if (m_name.empty() || std::strchr("-.0123456789\"'=<", m_name[0]) != nullptr) {
+                m_error = "malformed tag " + m_tag.substr(0, 64);
+                return false;
+            }
+
+            while (i < last) {
+                while (i < last && IsSpace(m_tag[i])) {
+                    ++i;
+                }
+                if (i == last) {
+                    break;
+                }
+                if (end) {
+                    m_error = "attributes on end tag " + m_tag.substr(0, 64);
+                    return false;
+                }
+                const std::size_t attributeStart = i;
+                while (i < last && m_tag[i] != '=' && !IsSpace(m_tag[i])) {
+                    ++i;
+                }
+                std::string attribute = m_tag.substr(attributeStart, i - attributeStart);
+                while (i < last && IsSpace(m_tag[i])) {
+                    ++i;
+                }
+                if (i == last || m_tag[i] != '=') {
+                    m_error = "attribute " + attribute + " has no value in <" + m_name + ">";
+                    return false;
+                }
+                ++i;
+                while (i < last && IsSpace(m_tag[i])) {
+                    ++i;
+                }
+                const char quote = i < last ? m_tag[i] : 0;
+                const std::size_t close = quote == '"' || quote == '\'' ? m_tag.find(quote, i + 1) : std::string::npos;
+                if (close == std::string::npos || close >= last) {
+                    m_error = "attribute " + attribute + " is not quoted in <" + m_name + ">";
+                    return false;
+                }
+                if (Attribute(attribute.c_str()) != nullptr) {
+                    m_error = "attribute " + attribute + " appears twice in <" + m_name + ">";
+                    return false;
+                }
+                m_attributes.emplace_back(std::move(attribute),
+                                          DecodeEntities(m_tag.substr(i + 1, close - i - 1)));
+                i = close + 1;
+            }
+            return true;
+        }
+    }
+
+    std::shared_ptr<CompiledScenario> ScenarioParser::Parse(std::istream &in, const std::string &name,
+                                                            std::string &error,
+                                                            std::vector<std::string> &problems) {
+        XmlScanner xml(in);
+        std::vector<std::string> open;
+
+        std::shared_ptr<CompiledScenario> scenario = std::make_shared<CompiledScenario>();
+        scenario->name = name;
+        bool sawRoot = false;
+        bool sawScenario = false;
+        bool sawMetadata = false;
+        bool sawCapabilities = false;
+        bool inScenario = false;
+        bool inCapabilities = false;
+        bool capabilitiesStarted = false;
+        bool capabilitiesStopped = false;
+
+        // The element being copied, if any, and the depth it was opened at.
+        std::string *capture = nullptr;
+        std::size_t captureDepth = 0;
+        CompiledCapability capability;
+        bool hasConfiguration = false;
+
+        auto startCapture = [&](std::string *out, std::size_t depth) {
+            capture = out;
+            captureDepth = depth;
+            xml.Capture(out);
+        };
+        auto finishCapture = [&] {
+            xml.Capture(nullptr);
+            if (capture == &capability.configuration) {
+                if (!hasConfiguration) {
+                    capability.configuration.clear();
+                }
+                scenario->capabilities.push_back(std::move(capability));
+                capability = CompiledCapability();
+            }
+            capture = nullptr;
+        };
+        auto flag = [&](const char *attribute, bool fallback) {
+            const std::string *value = xml.Attribute(attribute);
+            if (value == nullptr) {
+                return fallback;
+            }
+            if (*value != "true" && *value != "false") {
+                problems.push_back("capability " + capability.name + " has " + attribute + "=\"" + *value +
+                                   "\", expected true or false");
+            }
+            return fallback ? *value != "false" : *value == "true";
+        };
+
+        for (;;) {
+            const XmlScanner::Token token = xml.Next();
+            if (token == XmlScanner::Failed) {
+                error = "line " + std::to_string(xml.Line()) + ": " + xml.Error();
+                return nullptr;
+            }
+            if (token == XmlScanner::End) {
+                break;
+            }
+
+            const std::size_t depth = open.size();
+            if (token == XmlScanner::EndTag) {
+                if (open.empty() || open.back() != xml.Name()) {
+                    error = "line " + std::to_string(xml.Line()) + ": </" + xml.Name() + "> does not close " +
+                            (open.empty() ? std::string("anything") : "<" + open.back() + ">");
+                    return nullptr;
+                }
+                open.pop_back();
+                if (capture != nullptr && open.size() == captureDepth) {
+                    finishCapture();
+                }
+                if (open.size() == 2) {
+                    inCapabilities = false;
+                } else if (open.size() == 1) {
+                    inScenario = false;
+                }
+                continue;
+            }
+
+            if (depth == 0) {
+                if (sawRoot) {
+                    error = "line " + std::to_string(xml.Line()) + ": more than one root element";
+                    return nullptr;
+                }
+                sawRoot = true;
+            } else if (depth == 1 && !sawScenario) {
+                sawScenario = true;
+                inScenario = token == XmlScanner::StartTag;
+                const std::string *title = xml.Attribute("name");
+                if (title == nullptr) {
+                    problems.push_back("the scenario element has no name");
+                }
+                scenario->title = title == nullptr ? name : *title;
+            } else if (depth == 2 && inScenario) {
+                if (xml.Name() == "metadata" && !sawMetadata) {
+                    sawMetadata = true;
+                    startCapture(&scenario->metadata, depth);
+                } else if (xml.Name() == "capabilities" && !sawCapabilities) {
+                    sawCapabilities = true;
+                    inCapabilities = token == XmlScanner::StartTag;
+                }
+            } else if (depth == 3 && inCapabilities && !capabilitiesStopped &&
+                       (capabilitiesStarted || xml.Name() == "capability")) {
+                // Like the DOM walk this replaces: from the first <capability>, every sibling counts.
+                capabilitiesStarted = true;
+                const std::string *capabilityName = xml.Attribute("name");
+                if (capabilityName == nullptr) {
+                    problems.push_back("unnamed capability; it and those after it are ignored");
+                    capabilitiesStopped = true;
+                } else {
+                    if (xml.Name() != "capability") {
+                        problems.push_back("<" + xml.Name() + "> " + *capabilityName + " is treated as a capability");
+                    }
+                    for (const CompiledCapability &previous : scenario->capabilities) {
+                        if (previous.name == *capabilityName) {
+                            problems.push_back("capability " + *capabilityName + " is defined more than once");
+                            break;
+                        }
+                    }
+                    capability.name = *capabilityName;
+                    const std::string *moduleName = xml.Attribute("module_name");
+                    capability.moduleName = moduleName == nullptr ? "" : *moduleName;
+                    capability.required = flag("required", false);
+                    capability.enabled = flag("enabled", true);
+                    hasConfiguration = false;
+                    startCapture(&capability.configuration, depth);
+                }
+            } else if (depth == 4 && capture == &capability.configuration && xml.Name() == "configuration_data") {
+                hasConfiguration = true;
+            }
+
+            if (token == XmlScanner::StartTag) {
+                open.push_back(xml.Name());
+            } else if (capture != nullptr && depth == captureDepth) {
+                finishCapture();
+            }
+        }
+
+        if (!open.empty()) {
+            error = "<" + open.back() + "> is never closed";
+            return nullptr;
+        }
+        if (!sawScenario) {
+            error = "no scenario element";
+            return nullptr;
+        }
+        if (!capabilitiesStarted) {
+            problems.push_back("no capabilities");
+        }
+        return scenario;
+    }
+
+} // namespace AMM
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <istream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace AMM {
+
+    struct CompiledScenario;
+
+/// Reads a scenario in one streaming pass. The document is scanned a chunk at a time
+/// and only the <metadata> element and the <capability> elements with configuration
+/// are kept, each copied byte for byte from the file rather than re-serialized. Memory
+/// use is bounded by the chunk size and the kept payloads, not by the file size.
+    class ScenarioParser {
+
+    public:
+        static const std::size_t ChunkSize = 64 * 1024;
+
+        /// Longest single tag, attributes included, the parser accepts.
+        static const std::size_t MaxTagSize = 64 * 1024;
+
+        /// Null, with `error` set, if the document is not well-formed or has no scenario.
+        /// Problems the manager tolerates are appended to `problems`.
+        static std::shared_ptr<CompiledScenario> Parse(std::istream &in, const std::string &name,
+                                                       std::string &error, std::vector<std::string> &problems);
+    };
+
+} // namespace AMM
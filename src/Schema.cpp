@@ -0,0 +1,159 @@
+#include "Schema.h"
+
+#include "plog/Log.h"
+
+#include <sqlite3.h>
+
+namespace AMM {
+    namespace {
+        /// Maps the module_key stored with each event to the module it came from.
+        const char *ModulesTable = "create table if not exists modules ("
+                                   "module_key integer primary key,"
+                                   "module_guid text,"
+                                   "module_id text,"
+                                   "module_name text"
+                                   ");";
+    }
+
+    bool CreateTables(sqlite3 *db, std::string *error) {
+        struct Table {
+            const char *description;
+            const char *sql;
+        };
+        const Table tables[] = {
+                {"event log",
+                        "create table if not exists events("
+                        "source text,"
+                        "module_id text,"
+                        "module_guid text,"
+                        "module_name text,"
+                        "event_id text,"
+                        "topic text,"
+                        "timestamp bigint,"
+                        "data text,"
+                        "module_key integer,"
+                        "source_time bigint,"
+                        "receive_time bigint,"
+                        "commit_time bigint"
+                        ");"},
+                {"module capabilities",
+                        "create table if not exists module_capabilities ("
+                        "module_id text,"
+                        "module_guid text,"
+                        "module_name text,"
+                        "description text,"
+                        "manufacturer text,"
+                        "model text,"
+                        "module_version text,"
+                        "serial_number text,"
+                        "capabilities text,"
+                        "source_time bigint,"
+                        "receive_time bigint,"
+                        "commit_time bigint"
+                        ");"},
+                {"module status",
+                        "create table if not exists module_status ("
+                        "module_id text,"
+                        "module_guid text,"
+                        "module_name text,"
+                        "capability text,"
+                        "status text,"
+                        "message text,"
+                        "timestamp bigint,"
+                        "encounter_id text,"
+                        "source_time bigint,"
+                        "receive_time bigint,"
+                        "commit_time bigint"
+                        ");"},
+                {"log record",
+                        "create table if not exists logs("
+                        "module_id text,"
+                        "module_guid text,"
+                        "module_name text,"
+                        "message text,"
+                        "log_level text,"
+                        "timestamp bigint,"
+                        "source_time bigint,"
+                        "receive_time bigint,"
+                        "commit_time bigint"
+                        ");"},
+                {"module", ModulesTable},
+        };
+
+        bool ok = true;
+        for (const Table &table : tables) {
+            LOG_INFO << "Creating " << table.description << " table...";
+            if (sqlite3_exec(db, table.sql, nullptr, nullptr, nullptr) != SQLITE_OK) {
+                LOG_ERROR << sqlite3_errmsg(db);
+                if (ok && error != nullptr) {
+                    *error = std::string(table.description) + " table: " + sqlite3_errmsg(db);
+                }
+                ok = false;
+            }
+        }
+        return ok;
+    }
+
+    bool WipeTables(sqlite3 *db, std::string *error) {
+        const char *sql = "begin immediate;"
+                          "delete from events;"
+                          "delete from module_capabilities;"
+                          "delete from module_status;"
+                          "delete from logs;"
+                          "delete from modules;"
+                          "commit;";
+        char *message = nullptr;
+        if (sqlite3_exec(db, sql, nullptr, nullptr, &message) == SQLITE_OK) {
+            return true;
+        }
+        const std::string reason = message != nullptr ? message : sqlite3_errmsg(db);
+        sqlite3_free(message);
+        LOG_ERROR << "Unable to wipe tables: " << reason;
+        if (error != nullptr) {
+            *error = reason;
+        }
+        // A failed statement, or a commit that stayed busy, leaves the transaction open.
+        if (sqlite3_get_autocommit(db) == 0) {
+            sqlite3_exec(db, "rollback;", nullptr, nullptr, nullptr);
+        }
+        return false;
+    }
+
+    void EnsureColumn(sqlite3 *db, const std::string &table, const std::string &column, const std::string &type) {
+        sqlite3_stmt *info = nullptr;
+        bool exists = false;
+        bool found = false;
+        std::string sql = "pragma table_info(" + table + ");";
+        if (sqlite3_prepare_v2(db, sql.c_str(), -1, &info, nullptr) == SQLITE_OK) {
+            while (!found && sqlite3_step(info) == SQLITE_ROW) {
+                exists = true;
+                const unsigned char *name = sqlite3_column_text(info, 1);
+                found = name != nullptr && column == reinterpret_cast<const char *>(name);
+            }
+        }
+        sqlite3_finalize(info);
+
+        if (exists && !found) {
+            LOG_INFO << "Adding column " << column << " to " << table;
+            sql = "alter table " + table + " add column " + column + " " + type + ";";
+            if (sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr) != SQLITE_OK) {
+                LOG_ERROR << sqlite3_errmsg(db);
+            }
+        }
+    }
+
+    void UpgradeSchema(sqlite3 *db) {
+        // A database set up by an older -s run has no modules table yet.
+        if (sqlite3_exec(db, ModulesTable, nullptr, nullptr, nullptr) != SQLITE_OK) {
+            LOG_ERROR << sqlite3_errmsg(db);
+        }
+        EnsureColumn(db, "events", "module_key", "integer");
+
+        const char *timedTables[] = {"events", "logs", "module_status", "module_capabilities"};
+        for (const char *table : timedTables) {
+            EnsureColumn(db, table, "source_time", "bigint");
+            EnsureColumn(db, table, "receive_time", "bigint");
+            EnsureColumn(db, table, "commit_time", "bigint");
+        }
+    }
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <string>
+
+struct sqlite3;
+
+namespace AMM {
+
+/// How long the manager's table connections wait for a lock held by another connection.
+    const int BusyTimeoutMs = 1000;
+
+/// Creates the events, module_capabilities, module_status, logs and modules tables if they do not exist.
+/// On failure `error`, if given, receives the first table that could not be created and why.
+    bool CreateTables(sqlite3 *db, std::string *error = nullptr);
+
+/// Deletes every row from those tables in one immediate transaction, so a busy database leaves
+/// them all untouched rather than some wiped. On failure `error`, if given, receives the reason.
+    bool WipeTables(sqlite3 *db, std::string *error = nullptr);
+
+/// Adds a column to a table created by an older version of the manager.
+/// Missing tables are left alone; they are created by CreateTables.
+    void EnsureColumn(sqlite3 *db, const std::string &table, const std::string &column, const std::string &type);
+
+/// Brings tables created by older versions up to the current layout, creating the
+/// modules table if missing, so an existing amm.db keeps working without a -s run.
+    void UpgradeSchema(sqlite3 *db);
+
+} // namespace AMM
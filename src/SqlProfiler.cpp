@@ -0,0 +1,202 @@
+#include "SqlProfiler.h"
+
+#include "Clock.h"
+
+#include <sqlite3.h>
+
+#include <algorithm>
+#include <cctype>
+#include <iomanip>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace AMM {
+    namespace {
+        struct StatementStats {
+            uint64_t calls = 0;
+            uint64_t rows = 0;
+            int64_t totalNs = 0;
+            int64_t maxNs = 0;
+        };
+
+        std::mutex &StatsMutex() {
+            static std::mutex mutex;
+            return mutex;
+        }
+
+        std::unordered_map<std::string, StatementStats> &Stats() {
+            static std::unordered_map<std::string, StatementStats> stats;
+            return stats;
+        }
+
+        /// The statement currently stepping on this thread. SQLite's own profile
+        /// times have millisecond resolution, so statements are timed here instead.
+        struct Running {
+            sqlite3_stmt *stmt = nullptr;
+            int64_t start = 0;
+            uint64_t rows = 0;
+        };
+
+        thread_local Running t_running;
+
+        void OnStart(sqlite3_stmt *stmt) {
+            t_running.stmt = stmt;
+            t_running.start = Clock::NowNs();
+            t_running.rows = 0;
+        }
+
+        void OnRow(sqlite3_stmt *stmt) {
+            if (t_running.stmt == stmt) {
+                ++t_running.rows;
+            }
+        }
+
+        void OnProfile(sqlite3_stmt *stmt, int64_t elapsedNs) {
+            const bool timed = t_running.stmt == stmt;
+            if (timed) {
+                elapsedNs = Clock::NowNs() - t_running.start;
+            }
+            uint64_t rows = 0;
+            if (sqlite3_stmt_readonly(stmt)) {
+                rows = timed ? t_running.rows : 0;
+            } else {
+                rows = static_cast<uint64_t>(sqlite3_changes(sqlite3_db_handle(stmt)));
+            }
+            t_running.stmt = nullptr;
+
+            // Reuse the scratch capacity so steady-state profiling does not allocate.
+            thread_local std::string normalized;
+            SqlProfiler::Normalize(sqlite3_sql(stmt), normalized);
+
+            std::lock_guard<std::mutex> lock(StatsMutex());
+            auto &stats = Stats();
+            auto it = stats.find(normalized);
+            if (it == stats.end()) {
+                it = stats.emplace(normalized, StatementStats()).first;
+            }
+            StatementStats &entry = it->second;
+            ++entry.calls;
+            entry.rows += rows;
+            entry.totalNs += elapsedNs;
+            entry.maxNs = std::max(entry.maxNs, elapsedNs);
+        }
+
+        int OnTrace(unsigned type, void *, void *p, void *x) {
+            sqlite3_stmt *stmt = static_cast<sqlite3_stmt *>(p);
+            if (type == SQLITE_TRACE_STMT) {
+                OnStart(stmt);
+            } else if (type == SQLITE_TRACE_ROW) {
+                OnRow(stmt);
+            } else if (type == SQLITE_TRACE_PROFILE) {
+                OnProfile(stmt, *static_cast<sqlite3_int64 *>(x));
+            }
+            return 0;
+        }
+    }
+
+    std::atomic<bool> SqlProfiler::s_enabled{false};
+
+    void SqlProfiler::Enable(bool enabled) {
+        s_enabled.store(enabled, std::memory_order_relaxed);
+    }
+
+    void SqlProfiler::Attach(sqlite3 *db) {
+        if (db == nullptr || !Enabled()) {
+            return;
+        }
+        sqlite3_trace_v2(db, SQLITE_TRACE_STMT | SQLITE_TRACE_ROW | SQLITE_TRACE_PROFILE, &OnTrace, nullptr);
+    }
+
+    void SqlProfiler::Detach(sqlite3 *db) {
+        if (db != nullptr) {
+            sqlite3_trace_v2(db, 0, nullptr, nullptr);
+        }
+    }
+
+    void SqlProfiler::Reset() {
+        std::lock_guard<std::mutex> lock(StatsMutex());
+        Stats().clear();
+    }
+
+    void SqlProfiler::Normalize(const char *sql, std::string &out) {
+        out.clear();
+        if (sql == nullptr) {
+            return;
+        }
+        bool space = false;
+        for (const char *c = sql; *c != '\0'; ++c) {
+            const unsigned char ch = static_cast<unsigned char>(*c);
+            if (std::isspace(ch)) {
+                space = !out.empty();
+                continue;
+            }
+            if (space) {
+                out.push_back(' ');
+                space = false;
+            }
+            if (ch == '\'') {
+                // Skip the literal, including doubled '' escapes.
+                while (*++c != '\0') {
+                    if (*c == '\'' && *(c + 1) != '\'') {
+                        break;
+                    }
+                    if (*c == '\'') {
+                        ++c;
+                    }
+                }
+                out.push_back('?');
+                if (*c == '\0') {
+                    break;
+                }
+            } else if (std::isdigit(ch) && (out.empty() || !(std::isalnum(static_cast<unsigned char>(out.back())) ||
+                                                               out.back() == '_'))) {
+                while (std::isalnum(static_cast<unsigned char>(*(c + 1))) || *(c + 1) == '.') {
+                    ++c;
+                }
+                out.push_back('?');
+            } else {
+                out.push_back(*c);
+            }
+        }
+    }
+
+    void SqlProfiler::PrintReport(std::ostream &os, std::size_t limit) {
+        std::vector<std::pair<std::string, StatementStats>> rows;
+        {
+            std::lock_guard<std::mutex> lock(StatsMutex());
+            rows.assign(Stats().begin(), Stats().end());
+        }
+        if (rows.empty()) {
+            os << "No SQL statements profiled." << std::endl;
+            return;
+        }
+        std::sort(rows.begin(), rows.end(), [](const std::pair<std::string, StatementStats> &a,
+                                               const std::pair<std::string, StatementStats> &b) {
+            return a.second.totalNs > b.second.totalNs;
+        });
+
+        const std::ios::fmtflags flags = os.flags();
+        os << std::fixed << std::setprecision(3)
+           << std::setw(10) << "calls" << std::setw(12) << "total ms" << std::setw(12) << "mean us"
+           << std::setw(12) << "max us" << std::setw(12) << "rows" << "  statement" << std::endl;
+        const std::size_t count = std::min(limit, rows.size());
+        for (std::size_t i = 0; i < count; ++i) {
+            const StatementStats &stats = rows[i].second;
+            std::string statement = rows[i].first;
+            if (statement.size() > 80) {
+                statement = statement.substr(0, 77) + "...";
+            }
+            os << std::setw(10) << stats.calls
+               << std::setw(12) << stats.totalNs / 1e6
+               << std::setw(12) << stats.totalNs / 1e3 / static_cast<double>(stats.calls)
+               << std::setw(12) << stats.maxNs / 1e3
+               << std::setw(12) << stats.rows
+               << "  " << statement << std::endl;
+        }
+        if (rows.size() > count) {
+            os << "(" << rows.size() - count << " more statements)" << std::endl;
+        }
+        os.flags(flags);
+    }
+}
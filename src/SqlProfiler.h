@@ -0,0 +1,39 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+struct sqlite3;
+
+namespace AMM {
+
+/// Opt-in SQLite statement profiler. Attached connections report every finished
+/// statement through SQLITE_TRACE_PROFILE; timings are aggregated per normalized
+/// statement text (literals replaced by '?') so they can be ranked by total cost.
+    class SqlProfiler {
+
+    public:
+        /// Must be called before connections are attached; attaching is a no-op otherwise.
+        static void Enable(bool enabled);
+
+        static bool Enabled() { return s_enabled.load(std::memory_order_relaxed); }
+
+        static void Attach(sqlite3 *db);
+
+        static void Detach(sqlite3 *db);
+
+        /// Statements ordered by total time: calls, total, mean and max time, rows.
+        static void PrintReport(std::ostream &os, std::size_t limit = 20);
+
+        static void Reset();
+
+        /// Collapses whitespace and replaces string and numeric literals with '?'.
+        static void Normalize(const char *sql, std::string &out);
+
+    private:
+        static std::atomic<bool> s_enabled;
+    };
+
+} // namespace AMM
@@ -0,0 +1,187 @@
+#include "StatusBoard.h"
+
+#include "Clock.h"
+
+#include <ctime>
+#include <iomanip>
+
+namespace AMM {
+    namespace {
+        std::mutex &ErrorMutex() {
+            static std::mutex mutex;
+            return mutex;
+        }
+
+        std::pair<std::string, int64_t> &LastError() {
+            static std::pair<std::string, int64_t> error;
+            return error;
+        }
+
+        double Rate(uint64_t now, uint64_t before, int64_t elapsedNs) {
+            if (elapsedNs <= 0 || now < before) {
+                return 0;
+            }
+            return static_cast<double>(now - before) * 1e9 / static_cast<double>(elapsedNs);
+        }
+
+        std::string ClockTime(int64_t wallNs) {
+            const std::time_t seconds = static_cast<std::time_t>(wallNs / 1000000000);
+            std::tm local = {};
+#ifdef _WIN32
+            localtime_s(&local, &seconds);
+#else
+            localtime_r(&seconds, &local);
+#endif
+            char text[16];
+            std::strftime(text, sizeof(text), "%H:%M:%S", &local);
+            return text;
+        }
+
+        std::string Clip(const std::string &text, std::size_t width) {
+            return text.size() <= width ? text : text.substr(0, width - 1) + "~";
+        }
+    }
+
+    void StatusBoard::SetCapability(const ModuleRecord &module, const std::string &moduleName,
+                                    const std::string &capability, const std::string &value,
+                                    const std::string &message, uint64_t timestamp) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        StatusSnapshot::Capability &entry = m_capabilities[std::make_pair(module.key, capability)];
+        entry.module_key = module.key;
+        entry.module_name = moduleName;
+        entry.capability = capability;
+        entry.value = value;
+        entry.message = message;
+        entry.timestamp = timestamp;
+        m_disconnected.erase(module.key);
+    }
+
+    void StatusBoard::Disconnect(const ModuleRecord &module) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        EraseCapabilities(module.key);
+        m_disconnected.insert(module.key);
+    }
+
+    void StatusBoard::Forget(uint32_t key) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        EraseCapabilities(key);
+        m_disconnected.erase(key);
+    }
+
+    void StatusBoard::EraseCapabilities(uint32_t key) {
+        auto first = m_capabilities.lower_bound(std::make_pair(key, std::string()));
+        auto last = first;
+        while (last != m_capabilities.end() && last->first.first == key) {
+            ++last;
+        }
+        m_capabilities.erase(first, last);
+    }
+
+    std::shared_ptr<const StatusSnapshot> StatusBoard::Publish(std::shared_ptr<StatusSnapshot> snapshot) {
+        std::lock_guard<std::mutex> publishLock(m_publishMutex);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            snapshot->capabilities.reserve(m_capabilities.size());
+            for (const auto &entry : m_capabilities) {
+                snapshot->capabilities.push_back(entry.second);
+            }
+            for (StatusSnapshot::Module &module : snapshot->modules) {
+                module.disconnected = m_disconnected.count(module.key) != 0;
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(ErrorMutex());
+            snapshot->lastError = LastError().first;
+            snapshot->lastErrorTime = LastError().second;
+        }
+
+        std::shared_ptr<const StatusSnapshot> previous = Current();
+        if (previous) {
+            const int64_t elapsed = snapshot->taken - previous->taken;
+            for (std::size_t i = 0; i < snapshot->topics.size() && i < previous->topics.size(); ++i) {
+                snapshot->topics[i].rate = Rate(snapshot->topics[i].samples, previous->topics[i].samples, elapsed);
+            }
+            // Both snapshots list modules in key order, but evicted modules leave gaps, so match
+            // them by key. A module not in the previous snapshot, or restored from eviction with a
+            // fresh counter, received all of its samples since then.
+            auto before = previous->modules.begin();
+            for (StatusSnapshot::Module &module : snapshot->modules) {
+                while (before != previous->modules.end() && before->key < module.key) {
+                    ++before;
+                }
+                const bool known = before != previous->modules.end() && before->key == module.key &&
+                                   before->samples <= module.samples;
+                module.rate = Rate(module.samples, known ? before->samples : 0, elapsed);
+            }
+        }
+
+        std::shared_ptr<const StatusSnapshot> published = std::move(snapshot);
+        std::atomic_store(&m_current, published);
+        return published;
+    }
+
+    std::shared_ptr<const StatusSnapshot> StatusBoard::Current() const {
+        return std::atomic_load(&m_current);
+    }
+
+    void StatusBoard::RecordError(const std::string &message) {
+        std::lock_guard<std::mutex> lock(ErrorMutex());
+        LastError().first = message;
+        LastError().second = Clock::WallNs();
+    }
+
+    void LastErrorAppender::write(const plog::Record &record) {
+        if (record.getSeverity() > plog::error) {
+            return;
+        }
+        const std::basic_string<plog::util::nchar> message(record.getMessage());
+        StatusBoard::RecordError(std::string(message.begin(), message.end()));
+    }
+
+    void PrintStatus(const StatusSnapshot &snapshot, std::ostream &os) {
+        os << "Module Manager status at " << ClockTime(snapshot.wallTime) << std::endl << std::endl;
+
+        os << "Modules (" << snapshot.modules.size() << ")" << std::endl;
+        os << std::left << "  " << std::setw(5) << "key" << std::setw(24) << "name" << std::setw(38) << "module id"
+           << std::right << std::setw(10) << "samples" << std::setw(10) << "rate/s" << "  state" << std::endl;
+        for (const StatusSnapshot::Module &module : snapshot.modules) {
+            const char *state = module.disconnected ? "disconnected" : module.rate > 0 ? "active" : "idle";
+            os << std::left << "  " << std::setw(5) << module.key
+               << std::setw(24) << Clip(module.name.empty() ? module.guid : module.name, 23)
+               << std::setw(38) << Clip(module.module_id, 37) << std::right << std::setw(10) << module.samples
+               << std::setw(10) << std::fixed << std::setprecision(1) << module.rate << "  " << state << std::endl;
+        }
+
+        os << std::endl << "Capabilities (" << snapshot.capabilities.size() << ")" << std::endl;
+        for (const StatusSnapshot::Capability &capability : snapshot.capabilities) {
+            os << std::left << "  " << std::setw(24) << Clip(capability.module_name, 23)
+               << std::setw(28) << Clip(capability.capability, 27) << std::setw(14) << capability.value
+               << Clip(capability.message, 40) << std::right << std::endl;
+        }
+
+        os << std::endl << "Topics" << std::endl;
+        for (const StatusSnapshot::Topic &topic : snapshot.topics) {
+            if (topic.samples == 0) {
+                continue;
+            }
+            os << std::left << "  " << std::setw(28) << topic.name << std::right << std::setw(12) << topic.samples
+               << std::setw(10) << std::fixed << std::setprecision(1) << topic.rate << "/s" << std::endl;
+        }
+
+        os << std::endl << "Event queue: " << snapshot.eventQueue << " / " << snapshot.eventQueueCapacity
+           << " pending, " << snapshot.eventsCommitted << " committed, " << snapshot.eventsDropped << " dropped"
+           << std::endl;
+        os << "Capture: ";
+        if (snapshot.capturing) {
+            os << "recording, " << snapshot.captureRecords << " samples" << std::endl;
+        } else {
+            os << "off" << std::endl;
+        }
+        os << "Last error: ";
+        if (snapshot.lastError.empty()) {
+            os << "none" << std::endl;
+        } else {
+            os << "[" << ClockTime(snapshot.lastErrorTime) << "] " << snapshot.lastError << std::endl;
+        }
+    }
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "ModuleRegistry.h"
+
+#include "plog/Log.h"
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace AMM {
+
+/// Point-in-time view of the manager for the status console. Immutable once published.
+    struct StatusSnapshot {
+        struct Module {
+            uint32_t key = 0;
+            std::string guid;
+            std::string module_id;
+            std::string name;
+            uint64_t samples = 0;
+            double rate = 0;
+            bool disconnected = false;
+        };
+
+        struct Capability {
+            uint32_t module_key = 0;
+            std::string module_name;
+            std::string capability;
+            std::string value;
+            std::string message;
+            uint64_t timestamp = 0;
+        };
+
+        struct Topic {
+            std::string name;
+            uint64_t samples = 0;
+            double rate = 0;
+        };
+
+        /// Clock::NowNs() when taken, for rates, and wall time for display.
+        int64_t taken = 0;
+        int64_t wallTime = 0;
+
+        std::vector<Module> modules;
+        std::vector<Capability> capabilities;
+        std::vector<Topic> topics;
+
+        std::size_t eventQueue = 0;
+        std::size_t eventQueueCapacity = 0;
+        uint64_t eventsCommitted = 0;
+        uint64_t eventsDropped = 0;
+
+        bool capturing = false;
+        uint64_t captureRecords = 0;
+
+        std::string lastError;
+        int64_t lastErrorTime = 0;
+    };
+
+/// Status state for the console, kept apart from the ingest path. Listeners update
+/// capability status under a lock private to the board; snapshots are published
+/// RCU-style, so rendering only copies a shared_ptr and never touches SQLite or the
+/// ingest lock.
+    class StatusBoard {
+
+    public:
+        void SetCapability(const ModuleRecord &module, const std::string &moduleName, const std::string &capability,
+                           const std::string &value, const std::string &message, uint64_t timestamp);
+
+        /// Drops a module's capabilities after it says it is leaving.
+        void Disconnect(const ModuleRecord &module);
+
+        /// Drops everything kept for a module the registry has evicted.
+        void Forget(uint32_t key);
+
+        /// Fills in capabilities, disconnections, rates against the previous snapshot and the
+        /// last error, then makes it the current snapshot.
+        std::shared_ptr<const StatusSnapshot> Publish(std::shared_ptr<StatusSnapshot> snapshot);
+
+        std::shared_ptr<const StatusSnapshot> Current() const;
+
+        /// Remembers the most recent error, from any thread.
+        static void RecordError(const std::string &message);
+
+    private:
+        /// Erases a module's capabilities; the caller holds m_mutex.
+        void EraseCapabilities(uint32_t key);
+
+        mutable std::mutex m_mutex;
+        std::map<std::pair<uint32_t, std::string>, StatusSnapshot::Capability> m_capabilities;
+        std::set<uint32_t> m_disconnected;
+
+        /// Serializes publishers; readers go through atomic_load.
+        std::mutex m_publishMutex;
+        std::shared_ptr<const StatusSnapshot> m_current;
+    };
+
+/// Feeds error-or-worse log records to StatusBoard::RecordError.
+    class LastErrorAppender : public plog::IAppender {
+
+    public:
+        void write(const plog::Record &record) override;
+    };
+
+    /// Modules, capabilities, topic rates, queues and the last error as a console page.
+    void PrintStatus(const StatusSnapshot &snapshot, std::ostream &os);
+
+} // namespace AMM
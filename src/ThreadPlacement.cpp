@@ -0,0 +1,351 @@
+#include "ThreadPlacement.h"
+
+#include "Tracer.h"
+
+#include "plog/Log.h"
+
+#include <tinyxml2.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace AMM {
+    thread_local int ThreadPlacement::t_adopted = 0;
+
+    namespace {
+        const std::size_t RoleCount = static_cast<std::size_t>(ThreadRole::Count);
+
+        const char *RoleNames[RoleCount] = {"main", "listener", "control", "writer", "maintenance"};
+
+        struct PlacedThread {
+            std::string name;
+            ThreadRole role;
+            long tid;
+            std::string layout;
+            std::string error;
+        };
+
+        std::mutex &PlacementMutex() {
+            static std::mutex mutex;
+            return mutex;
+        }
+
+        ThreadPolicy *Policies() {
+            static ThreadPolicy policies[RoleCount];
+            return policies;
+        }
+
+        std::vector<PlacedThread> &Placed() {
+            static std::vector<PlacedThread> placed;
+            return placed;
+        }
+
+        /// Parses "0-3,6" into {0, 1, 2, 3, 6}.
+        bool ParseCpus(const std::string &text, std::vector<int> &cpus) {
+            std::istringstream in(text);
+            std::string range;
+            while (std::getline(in, range, ',')) {
+                int first = 0;
+                int last = 0;
+                char dash = 0;
+                std::istringstream part(range);
+                if (!(part >> first)) {
+                    return false;
+                }
+                last = first;
+                if (part >> dash && (dash != '-' || !(part >> last))) {
+                    return false;
+                }
+                for (int cpu = first; cpu <= last; ++cpu) {
+                    cpus.push_back(cpu);
+                }
+            }
+            return !cpus.empty();
+        }
+
+        std::string Describe(const ThreadPolicy &policy) {
+            std::ostringstream out;
+            if (policy.cpus.empty()) {
+                out << "cpus any";
+            } else {
+                out << "cpus";
+                for (std::size_t i = 0; i < policy.cpus.size(); ++i) {
+                    out << (i == 0 ? " " : ",") << policy.cpus[i];
+                }
+            }
+            switch (policy.scheduling) {
+                case ThreadPolicy::Inherit:
+                    out << ", inherited scheduling";
+                    break;
+                case ThreadPolicy::Normal:
+                    out << ", normal";
+                    break;
+                case ThreadPolicy::Fifo:
+                    out << ", fifo " << policy.priority;
+                    break;
+                case ThreadPolicy::RoundRobin:
+                    out << ", rr " << policy.priority;
+                    break;
+            }
+            if (policy.setNice) {
+                out << ", nice " << policy.nice;
+            }
+            return out.str();
+        }
+
+        long CurrentTid() {
+#ifdef __linux__
+            return static_cast<long>(syscall(SYS_gettid));
+#else
+            return 0;
+#endif
+        }
+
+        /// Applies `policy` to the calling thread; returns a description of anything that failed.
+        std::string ApplyPolicy(const ThreadPolicy &policy, long tid) {
+            std::string error;
+#ifdef __linux__
+            if (!policy.cpus.empty()) {
+                cpu_set_t set;
+                CPU_ZERO(&set);
+                for (int cpu : policy.cpus) {
+                    CPU_SET(cpu, &set);
+                }
+                int result = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+                if (result != 0) {
+                    error += std::string("affinity: ") + std::strerror(result) + "; ";
+                }
+            }
+            if (policy.scheduling != ThreadPolicy::Inherit) {
+                const int schedPolicy = policy.scheduling == ThreadPolicy::Fifo ? SCHED_FIFO
+                                        : policy.scheduling == ThreadPolicy::RoundRobin ? SCHED_RR : SCHED_OTHER;
+                sched_param param = {};
+                param.sched_priority = schedPolicy == SCHED_OTHER ? 0 : policy.priority;
+                int result = pthread_setschedparam(pthread_self(), schedPolicy, &param);
+                if (result != 0) {
+                    error += std::string("scheduling: ") + std::strerror(result) + "; ";
+                }
+            }
+            if (policy.setNice && setpriority(PRIO_PROCESS, static_cast<id_t>(tid), policy.nice) != 0) {
+                error += std::string("nice: ") + std::strerror(errno) + "; ";
+            }
+#else
+            if (!policy.cpus.empty() || policy.scheduling != ThreadPolicy::Inherit || policy.setNice) {
+                error = "not supported on this platform; ";
+            }
+#endif
+            if (!error.empty()) {
+                error.resize(error.size() - 2);
+            }
+            return error;
+        }
+
+        bool PlacedAlike(const ThreadPolicy &a, const ThreadPolicy &b) {
+            return a.cpus == b.cpus && a.scheduling == b.scheduling && a.priority == b.priority &&
+                   a.setNice == b.setNice && a.nice == b.nice;
+        }
+
+        void Place(ThreadRole role, const std::string &name, bool rename) {
+            const long tid = CurrentTid();
+#ifdef __linux__
+            // Renaming the main thread would rename the process as ps and pkill see it.
+            if (rename && tid != static_cast<long>(getpid())) {
+                pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());
+            }
+#endif
+            if (rename) {
+                Tracer::SetThreadName(name);
+            }
+
+            std::lock_guard<std::mutex> lock(PlacementMutex());
+            const ThreadPolicy &policy = Policies()[static_cast<std::size_t>(role)];
+            PlacedThread placed{name, role, tid, Describe(policy), ApplyPolicy(policy, tid)};
+            if (!placed.error.empty()) {
+                LOG_WARNING << "Unable to place " << name << " as " << ThreadRoleName(role) << ": " << placed.error;
+            }
+
+            // Threads come and go (the startup helper, a re-adopted listener); keep the latest entry per tid.
+            std::vector<PlacedThread> &all = Placed();
+            for (PlacedThread &existing : all) {
+                if (existing.tid == tid) {
+                    existing = placed;
+                    return;
+                }
+            }
+            all.push_back(placed);
+        }
+    }
+
+    const char *ThreadRoleName(ThreadRole role) {
+        return RoleNames[static_cast<std::size_t>(role)];
+    }
+
+    bool ThreadPlacement::Load(const std::string &fileName) {
+        tinyxml2::XMLDocument doc;
+        if (doc.LoadFile(fileName.c_str()) != tinyxml2::XML_SUCCESS) {
+            LOG_ERROR << "Unable to load thread placement from " << fileName;
+            return false;
+        }
+        tinyxml2::XMLElement *root = doc.FirstChildElement("Threads");
+        if (root == nullptr) {
+            LOG_ERROR << fileName << " has no <Threads> element";
+            return false;
+        }
+
+        bool valid = true;
+        for (tinyxml2::XMLElement *node = root->FirstChildElement("Thread"); node != nullptr;
+             node = node->NextSiblingElement("Thread")) {
+            const char *roleName = node->Attribute("role");
+            std::size_t role = 0;
+            while (role < RoleCount && (roleName == nullptr || std::strcmp(roleName, RoleNames[role]) != 0)) {
+                ++role;
+            }
+            if (role == RoleCount) {
+                LOG_ERROR << "Unknown thread role " << (roleName != nullptr ? roleName : "(none)");
+                valid = false;
+                continue;
+            }
+
+            ThreadPolicy policy;
+            tinyxml2::XMLElement *cpus = node->FirstChildElement("cpus");
+            if (cpus != nullptr && cpus->GetText() != nullptr && !ParseCpus(cpus->GetText(), policy.cpus)) {
+                LOG_ERROR << "Bad CPU list for " << roleName << " threads: " << cpus->GetText();
+                valid = false;
+            }
+            tinyxml2::XMLElement *scheduling = node->FirstChildElement("policy");
+            if (scheduling != nullptr && scheduling->GetText() != nullptr) {
+                const std::string name = scheduling->GetText();
+                if (name == "fifo") {
+                    policy.scheduling = ThreadPolicy::Fifo;
+                } else if (name == "rr") {
+                    policy.scheduling = ThreadPolicy::RoundRobin;
+                } else if (name == "normal") {
+                    policy.scheduling = ThreadPolicy::Normal;
+                } else {
+                    LOG_ERROR << "Unknown scheduling policy " << name << " for " << roleName << " threads";
+                    valid = false;
+                }
+            }
+            tinyxml2::XMLElement *priority = node->FirstChildElement("priority");
+            if (priority != nullptr) {
+                priority->QueryIntText(&policy.priority);
+            }
+            tinyxml2::XMLElement *nice = node->FirstChildElement("nice");
+            if (nice != nullptr) {
+                policy.setNice = nice->QueryIntText(&policy.nice) == tinyxml2::XML_SUCCESS;
+            }
+            Set(static_cast<ThreadRole>(role), policy);
+        }
+        return valid;
+    }
+
+    void ThreadPlacement::Set(ThreadRole role, const ThreadPolicy &policy) {
+        std::lock_guard<std::mutex> lock(PlacementMutex());
+        Policies()[static_cast<std::size_t>(role)] = policy;
+    }
+
+    void ThreadPlacement::Apply(ThreadRole role, const std::string &name) {
+        t_adopted = static_cast<int>(role) + 1;
+        Place(role, name, true);
+    }
+
+    void ThreadPlacement::AdoptSlow(ThreadRole role) {
+        t_adopted = static_cast<int>(role) + 1;
+        std::string name = "dds";
+#ifdef __linux__
+        char current[16] = {};
+        if (pthread_getname_np(pthread_self(), current, sizeof(current)) == 0 && current[0] != 0) {
+            name = current;
+        }
+#endif
+        Place(role, name, false);
+        LOG_INFO << "Adopted thread " << name << " (" << CurrentTid() << ") as " << ThreadRoleName(role);
+    }
+
+    void ThreadPlacement::Elevation::Raise(ThreadRole role) {
+#ifdef __linux__
+        ThreadPolicy policy;
+        {
+            std::lock_guard<std::mutex> lock(PlacementMutex());
+            policy = Policies()[static_cast<std::size_t>(role)];
+            const ThreadPolicy current = t_adopted > 0 ? Policies()[t_adopted - 1] : ThreadPolicy();
+            if (PlacedAlike(policy, current)) {
+                return;
+            }
+        }
+
+        const long tid = CurrentTid();
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (pthread_getaffinity_np(pthread_self(), sizeof(set), &set) == 0) {
+            for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+                if (CPU_ISSET(cpu, &set)) {
+                    m_cpus.push_back(cpu);
+                }
+            }
+        }
+        sched_param param = {};
+        if (pthread_getschedparam(pthread_self(), &m_scheduling, &param) != 0) {
+            return;
+        }
+        m_priority = param.sched_priority;
+        errno = 0;
+        m_nice = getpriority(PRIO_PROCESS, static_cast<id_t>(tid));
+        if (errno != 0) {
+            return;
+        }
+        m_saved = true;
+
+        const std::string error = ApplyPolicy(policy, tid);
+        static std::atomic<bool> warned{false};
+        if (!error.empty() && !warned.exchange(true)) {
+            LOG_WARNING << "Unable to raise a listener thread to " << ThreadRoleName(role) << ": " << error;
+        }
+#else
+        (void) role;
+#endif
+    }
+
+    void ThreadPlacement::Elevation::Restore() {
+#ifdef __linux__
+        if (!m_cpus.empty()) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            for (int cpu : m_cpus) {
+                CPU_SET(cpu, &set);
+            }
+            pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        }
+        sched_param param = {};
+        param.sched_priority = m_priority;
+        pthread_setschedparam(pthread_self(), m_scheduling, &param);
+        setpriority(PRIO_PROCESS, static_cast<id_t>(CurrentTid()), m_nice);
+#endif
+    }
+
+    void ThreadPlacement::Report(std::ostream &os) {
+        std::lock_guard<std::mutex> lock(PlacementMutex());
+        os << std::left << std::setw(20) << "thread" << std::setw(8) << "tid" << std::setw(13) << "role"
+           << "placement" << std::right << std::endl;
+        for (const PlacedThread &placed : Placed()) {
+            os << std::left << std::setw(20) << placed.name << std::setw(8) << placed.tid << std::setw(13)
+               << ThreadRoleName(placed.role) << placed.layout;
+            if (!placed.error.empty()) {
+                os << " (failed: " << placed.error << ")";
+            }
+            os << std::right << std::endl;
+        }
+    }
+}
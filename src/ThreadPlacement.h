@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace AMM {
+
+/// What a thread does; each role can be given its own CPUs and scheduling.
+    enum class ThreadRole : uint8_t {
+        Main = 0,
+        Listener,
+        Control,
+        Writer,
+        Maintenance,
+        Count
+    };
+
+    const char *ThreadRoleName(ThreadRole role);
+
+    struct ThreadPolicy {
+        enum Scheduling {
+            Inherit,
+            Normal,
+            Fifo,
+            RoundRobin
+        };
+
+        /// CPUs the thread may run on; empty leaves the inherited mask alone.
+        std::vector<int> cpus;
+        Scheduling scheduling = Inherit;
+        /// Real-time priority (1-99) for Fifo and RoundRobin.
+        int priority = 0;
+        bool setNice = false;
+        int nice = 0;
+    };
+
+/// CPU affinity, scheduling class and names for the manager's threads, configured per
+/// role. Threads the manager starts call Apply() first thing; DDS listener threads are
+/// not ours, so they are adopted from inside their first callback instead, and raised to
+/// Control only while they handle a control sample. Linux only; elsewhere threads are just
+/// named.
+    class ThreadPlacement {
+
+    public:
+        /// Reads role policies from an XML file of <Thread role="..."> elements.
+        static bool Load(const std::string &fileName);
+
+        static void Set(ThreadRole role, const ThreadPolicy &policy);
+
+        /// Names the calling thread and applies its role's policy.
+        static void Apply(ThreadRole role, const std::string &name);
+
+        /// Applies `role` to the calling thread unless it already has it or a later role.
+        static void Adopt(ThreadRole role) {
+            if (t_adopted < static_cast<int>(role) + 1) {
+                AdoptSlow(role);
+            }
+        }
+
+        /// Runs the calling thread under `role` for the scope and then puts back the affinity and
+        /// scheduling it had. DDS receive threads are shared by every topic, so control samples
+        /// get the Control policy this way rather than by adopting the thread for good. Does
+        /// nothing when the thread already has `role` or the two roles are placed alike.
+        class Elevation {
+
+        public:
+            explicit Elevation(ThreadRole role) {
+                if (t_adopted != static_cast<int>(role) + 1) {
+                    Raise(role);
+                }
+            }
+
+            ~Elevation() {
+                if (m_saved) {
+                    Restore();
+                }
+            }
+
+            Elevation(const Elevation &) = delete;
+
+            Elevation &operator=(const Elevation &) = delete;
+
+        private:
+            void Raise(ThreadRole role);
+
+            void Restore();
+
+            bool m_saved = false;
+            int m_scheduling = 0;
+            int m_priority = 0;
+            int m_nice = 0;
+            std::vector<int> m_cpus;
+        };
+
+        /// Every placed thread with its role, CPUs, scheduling and any error applying it.
+        static void Report(std::ostream &os);
+
+    private:
+        static void AdoptSlow(ThreadRole role);
+
+        /// Role + 1 this thread was adopted with, 0 if none.
+        static thread_local int t_adopted;
+    };
+
+} // namespace AMM
@@ -0,0 +1,374 @@
+#pragma once
+
+#include "amm_std.h"
+
+#include "amm/Utility.h"
+
+#include "ModuleRegistry.h"
+#include "Topics.h"
+
+#include "thirdparty/sqlite_modern_cpp.h"
+
+#include <boost/utility/string_view.hpp>
+
+#include <ostream>
+#include <string>
+
+namespace AMM {
+
+/// Storage mappings a topic can declare.
+/// EventStorage:  one row in events, batched through LogWriter (EventId/Format).
+/// TableStorage:  one statement against the topic's own table (Statement/Bind).
+/// NoStorage:     nothing is persisted by the generic path.
+    struct EventStorage {
+    };
+
+    struct TableStorage {
+    };
+
+    struct NoStorage {
+    };
+
+/// Per-thread scratch space for event data. It is cleared but never shrunk,
+/// so formatting a steady stream of events does not touch the heap.
+    inline std::string &ScratchBuffer() {
+        thread_local std::string buffer;
+        buffer.clear();
+        return buffer;
+    }
+
+/// Views std::string and fixed-size IDL strings alike without copying them.
+    template<typename String>
+    inline boost::string_view AsView(const String &value) {
+        return boost::string_view(value.c_str(), value.size());
+    }
+
+    inline void AppendNumber(std::string &out, uint64_t value) {
+        char digits[20];
+        int count = 0;
+        do {
+            digits[count++] = static_cast<char>('0' + value % 10);
+            value /= 10;
+        } while (value != 0);
+        while (count > 0) {
+            out.push_back(digits[--count]);
+        }
+    }
+
+/// Formats the "[tag]data" payload stored for most events.
+    inline void AppendTagged(std::string &out, boost::string_view tag, boost::string_view data) {
+        out.push_back('[');
+        out.append(tag.data(), tag.size());
+        out.push_back(']');
+        out.append(data.data(), data.size());
+    }
+
+/// Compile-time description of a subscribed topic. Every specialization provides:
+///   Id                         - interned topic id
+///   Storage                    - one of the storage mappings above
+///   Trace(os, sample)          - trace output for a received sample
+///   Accept(sample)             - false to ignore the sample entirely
+///   Timestamp(sample, sourceMs) - timestamp column, in milliseconds; topics without
+///                                 their own timestamp use the DDS source timestamp
+/// plus EventId/Format for EventStorage, or Statement/Bind for TableStorage. Table
+/// statements end with source_time, receive_time and commit_time, which Bind leaves
+/// for the caller.
+/// Adding a topic means adding a specialization and a subscriber.
+    template<typename Topic>
+    struct TopicTraits;
+
+/// Defaults shared by most specializations.
+    struct TopicTraitsBase {
+        template<typename Topic>
+        static bool Accept(const Topic &) { return true; }
+
+        template<typename Topic>
+        static uint64_t Timestamp(const Topic &, uint64_t sourceMs) { return sourceMs; }
+    };
+
+/// Streams a sample through its traits, so trace text is only built when tracing is enabled.
+    template<typename Topic>
+    struct TraceView {
+        const Topic &sample;
+    };
+
+    template<typename Topic>
+    inline std::ostream &operator<<(std::ostream &os, const TraceView<Topic> &view) {
+        TopicTraits<Topic>::Trace(os, view.sample);
+        return os;
+    }
+
+    template<typename Topic>
+    inline TraceView<Topic> Traced(const Topic &sample) {
+        return TraceView<Topic>{sample};
+    }
+
+    template<>
+    struct TopicTraits<AMM::Log> : TopicTraitsBase {
+        static const TopicId Id = TopicId::Log;
+        typedef TableStorage Storage;
+
+        static void Trace(std::ostream &os, const AMM::Log &log) {
+            os << "Log recieved:\n"
+               << "Timestamp: " << log.timestamp() << "\n"
+               << "Module ID: " << log.module_id().id() << "\n"
+               << "Level:     " << AMM::Utility::ELogLevelStr(log.level()) << "\n"
+               << "Message:   " << log.message();
+        }
+
+        static const char *Statement() {
+            return "insert into logs (module_id, module_guid, message, log_level, timestamp, "
+                   "source_time, receive_time, commit_time) values (?,?,?,?,?,?,?,?);";
+        }
+
+        static void Bind(sqlite::database_binder &binder, const AMM::Log &log, const ModuleRecord &module) {
+            binder << log.module_id().id()
+                   << module.guid
+                   << log.message()
+                   << AMM::Utility::ELogLevelStr(log.level())
+                   << log.timestamp();
+        }
+    };
+
+    template<>
+    struct TopicTraits<AMM::ModuleConfiguration> : TopicTraitsBase {
+        static const TopicId Id = TopicId::ModuleConfiguration;
+        typedef NoStorage Storage;
+
+        static void Trace(std::ostream &os, const AMM::ModuleConfiguration &mc) {
+            os << "Module Configuration recieved:\n"
+               << "Name:         " << mc.name() << "\n"
+               << "Module ID:    " << mc.module_id().id() << "\n"
+               << "Encounter:    " << mc.educational_encounter().id() << "\n"
+               << "Timestamp:    " << mc.timestamp() << "\n"
+               << "Capabilities: Not shown";
+        }
+    };
+
+    template<>
+    struct TopicTraits<AMM::Status> : TopicTraitsBase {
+        static const TopicId Id = TopicId::Status;
+        typedef TableStorage Storage;
+
+        static void Trace(std::ostream &os, const AMM::Status &status) {
+            os << "Status recieved:\n"
+               << "Module ID:   " << status.module_id().id() << "\n"
+               << "Module Name: " << status.module_name() << "\n"
+               << "Encounter:   " << status.educational_encounter().id() << "\n"
+               << "Capability:  " << status.capability() << "\n"
+               << "Timestamp:   " << status.timestamp() << "\n"
+               << "Value:       " << AMM::Utility::EStatusValueStr(status.value()) << "\n"
+               << "Message:     " << status.message();
+        }
+
+        static const char *Statement() {
+            return "replace into module_status (module_id, module_guid, module_name, "
+                   "capability, status, message, timestamp, encounter_id, "
+                   "source_time, receive_time, commit_time) values (?,?,?,?,?,?,?,?,?,?,?);";
+        }
+
+        static void Bind(sqlite::database_binder &binder, const AMM::Status &status, const ModuleRecord &module) {
+            binder << status.module_id().id() << module.guid << status.module_name()
+                   << status.capability() << AMM::Utility::EStatusValueStr(status.value())
+                   << status.message()
+                   << status.timestamp() << status.educational_encounter().id();
+        }
+    };
+
+    template<>
+    struct TopicTraits<AMM::SimulationControl> : TopicTraitsBase {
+        static const TopicId Id = TopicId::SimulationControl;
+        typedef EventStorage Storage;
+
+        static void Trace(std::ostream &os, const AMM::SimulationControl &simControl) {
+            os << "Simulation Control recieved:\n"
+               << "Timestamp: " << simControl.timestamp() << "\n"
+               << "Type:      " << AMM::Utility::EControlTypeStr(simControl.type()) << "\n"
+               << "Encounter: " << simControl.educational_encounter().id();
+        }
+
+        static uint64_t Timestamp(const AMM::SimulationControl &simControl, uint64_t) {
+            return simControl.timestamp();
+        }
+
+        static boost::string_view EventId(const AMM::SimulationControl &) { return "n/a"; }
+
+        static void Format(const AMM::SimulationControl &simControl, std::string &out) {
+            out += "[";
+            out += AMM::Utility::EControlTypeStr(simControl.type());
+            out += "]";
+        }
+    };
+
+    template<>
+    struct TopicTraits<AMM::Assessment> : TopicTraitsBase {
+        static const TopicId Id = TopicId::Assessment;
+        typedef EventStorage Storage;
+
+        static void Trace(std::ostream &os, const AMM::Assessment &assessment) {
+            os << "Assessment recieved:\n"
+               << "ID:       " << assessment.id().id() << "\n"
+               << "Event ID: " << assessment.event_id().id() << "\n"
+               << "Value:    " << AMM::Utility::EAssessmentValueStr(assessment.value()) << "\n"
+               << "Comment:  " << assessment.comment();
+        }
+
+        static boost::string_view EventId(const AMM::Assessment &assessment) {
+            return assessment.event_id().id();
+        }
+
+        static void Format(const AMM::Assessment &assessment, std::string &out) {
+            out += "[";
+            AppendNumber(out, assessment.value());
+            out += "]";
+            out += assessment.comment();
+        }
+    };
+
+/// EventFragment, EventRecord and OmittedEvent share their layout.
+    template<typename Event, TopicId EventTopic>
+    struct EventTraits : TopicTraitsBase {
+        static const TopicId Id = EventTopic;
+        typedef EventStorage Storage;
+
+        static void TraceFields(std::ostream &os, const Event &event) {
+            os << "ID:        " << event.id().id() << "\n"
+               << "Timestamp: " << event.timestamp() << "\n"
+               << "Encounter: " << event.educational_encounter().id() << "\n"
+               << "Location:  " << event.location().name() << " - " << event.location().FMAID() << "\n"
+               << "Agent:     " << AMM::Utility::EEventAgentTypeStr(event.agent_type()) << "\n"
+               << "Agent ID:  " << event.agent_id().id() << "\n"
+               << "Type:      " << event.type() << "\n"
+               << "Data:      " << event.data();
+        }
+
+        static uint64_t Timestamp(const Event &event, uint64_t) { return event.timestamp(); }
+
+        static boost::string_view EventId(const Event &event) { return event.id().id(); }
+
+        static void Format(const Event &event, std::string &out) {
+            AppendTagged(out, event.type(), AsView(event.data()));
+        }
+    };
+
+    template<>
+    struct TopicTraits<AMM::EventFragment> : EventTraits<AMM::EventFragment, TopicId::EventFragment> {
+        static void Trace(std::ostream &os, const AMM::EventFragment &ef) {
+            os << "Event Fragment recieved:\n";
+            TraceFields(os, ef);
+        }
+    };
+
+    template<>
+    struct TopicTraits<AMM::EventRecord> : EventTraits<AMM::EventRecord, TopicId::EventRecord> {
+        static void Trace(std::ostream &os, const AMM::EventRecord &er) {
+            os << "Event Record recieved:\n";
+            TraceFields(os, er);
+        }
+    };
+
+    template<>
+    struct TopicTraits<AMM::OmittedEvent> : EventTraits<AMM::OmittedEvent, TopicId::OmittedEvent> {
+        static void Trace(std::ostream &os, const AMM::OmittedEvent &omittedEvent) {
+            os << "Omitted Event recieved:\n";
+            TraceFields(os, omittedEvent);
+        }
+    };
+
+    template<>
+    struct TopicTraits<AMM::FragmentAmendmentRequest> : TopicTraitsBase {
+        static const TopicId Id = TopicId::FragmentAmendmentRequest;
+        typedef EventStorage Storage;
+
+        static void Trace(std::ostream &os, const AMM::FragmentAmendmentRequest &ffar) {
+            os << "Fragment Amendment Request recieved:\n"
+               << "ID:          " << ffar.id().id() << "\n"
+               << "Fragment ID: " << ffar.fragment_id().id() << "\n"
+               << "Status:      " << AMM::Utility::EFarStatusStr(ffar.status()) << "\n"
+               << "Location:    " << ffar.location().name() << " - " << ffar.location().FMAID() << "\n"
+               << "Agent:       " << AMM::Utility::EEventAgentTypeStr(ffar.agent_type()) << "\n"
+               << "Agent ID:    " << ffar.agent_id().id();
+        }
+
+        static boost::string_view EventId(const AMM::FragmentAmendmentRequest &ffar) { return ffar.id().id(); }
+
+        static void Format(const AMM::FragmentAmendmentRequest &ffar, std::string &out) {
+            AppendTagged(out, ffar.fragment_id().id(), boost::string_view());
+            AppendNumber(out, ffar.status());
+        }
+    };
+
+    template<>
+    struct TopicTraits<AMM::OperationalDescription> : TopicTraitsBase {
+        static const TopicId Id = TopicId::OperationalDescription;
+        typedef NoStorage Storage;
+
+        static void Trace(std::ostream &os, const AMM::OperationalDescription &opDescript) {
+            os << "Operational Description recieved:\n"
+               << "Name:         " << opDescript.name() << "\n"
+               << "Model:        " << opDescript.model() << "\n"
+               << "Module ID:    " << opDescript.module_id().id();
+        }
+    };
+
+/// Render and physiology modifications share their layout.
+    template<typename Modification, TopicId ModificationTopic>
+    struct ModificationTraits : TopicTraitsBase {
+        static const TopicId Id = ModificationTopic;
+        typedef EventStorage Storage;
+
+        static void TraceFields(std::ostream &os, const Modification &mod) {
+            os << "ID:       " << mod.id().id() << "\n"
+               << "Event ID: " << mod.event_id().id() << "\n"
+               << "Type:     " << mod.type() << "\n"
+               << "Data:     " << mod.data();
+        }
+
+        static boost::string_view EventId(const Modification &mod) { return mod.event_id().id(); }
+
+        static void Format(const Modification &mod, std::string &out) {
+            AppendTagged(out, mod.type(), AsView(mod.data()));
+        }
+    };
+
+    template<>
+    struct TopicTraits<AMM::RenderModification>
+            : ModificationTraits<AMM::RenderModification, TopicId::RenderModification> {
+        /// Inhale/exhale messages are too frequent to be worth storing.
+        static bool Accept(const AMM::RenderModification &rendMod) {
+            return AsView(rendMod.data()).find("START_OF") == boost::string_view::npos;
+        }
+
+        static void Trace(std::ostream &os, const AMM::RenderModification &rendMod) {
+            os << "Render Modification recieved:\n";
+            TraceFields(os, rendMod);
+        }
+    };
+
+    template<>
+    struct TopicTraits<AMM::PhysiologyModification>
+            : ModificationTraits<AMM::PhysiologyModification, TopicId::PhysiologyModification> {
+        static void Trace(std::ostream &os, const AMM::PhysiologyModification &physMod) {
+            os << "Physiology Modification recieved:\n";
+            TraceFields(os, physMod);
+        }
+    };
+
+    template<>
+    struct TopicTraits<AMM::Command> : TopicTraitsBase {
+        static const TopicId Id = TopicId::Command;
+        typedef EventStorage Storage;
+
+        static void Trace(std::ostream &os, const AMM::Command &command) {
+            os << "Command recieved:\n"
+               << "Message:" << command.message();
+        }
+
+        static boost::string_view EventId(const AMM::Command &) { return "n/a"; }
+
+        static void Format(const AMM::Command &command, std::string &out) {
+            out += command.message();
+        }
+    };
+
+} // namespace AMM
@@ -0,0 +1,28 @@
+#include "Topics.h"
+
+#include "amm/TopicNames.h"
+
+namespace AMM {
+    const std::string &TopicName(TopicId id) {
+        // Indexed by TopicId; names are resolved once so entries never copy them.
+        static const std::string *names[TopicCount] = {
+                &AMM::TopicNames::SimControl,
+                &AMM::TopicNames::Assessment,
+                &AMM::TopicNames::Log,
+                &AMM::TopicNames::RenderModification,
+                &AMM::TopicNames::PhysiologyModification,
+                &AMM::TopicNames::EventRecord,
+                &AMM::TopicNames::EventFragment,
+                &AMM::TopicNames::Command,
+                &AMM::TopicNames::FragmentAmendmentRequest,
+                &AMM::TopicNames::OmittedEvent,
+                &AMM::TopicNames::OperationalDescription,
+                &AMM::TopicNames::ModuleConfiguration,
+                &AMM::TopicNames::Status
+        };
+        static const std::string unknown = "Unknown";
+
+        std::size_t index = static_cast<std::size_t>(id);
+        return index < TopicCount ? *names[index] : unknown;
+    }
+}
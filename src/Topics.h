@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace AMM {
+
+/// Compact identifiers for every topic the Module Manager subscribes to.
+    enum class TopicId : uint8_t {
+        SimulationControl = 0,
+        Assessment,
+        Log,
+        RenderModification,
+        PhysiologyModification,
+        EventRecord,
+        EventFragment,
+        Command,
+        FragmentAmendmentRequest,
+        OmittedEvent,
+        OperationalDescription,
+        ModuleConfiguration,
+        Status,
+        Count
+    };
+
+    const std::size_t TopicCount = static_cast<std::size_t>(TopicId::Count);
+
+/// Interned topic name, as published in AMM::TopicNames.
+    const std::string &TopicName(TopicId id);
+
+} // namespace AMM
@@ -0,0 +1,154 @@
+#include "Tracer.h"
+
+#include "Clock.h"
+
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace AMM {
+    namespace {
+        struct TraceEvent {
+            const char *name;
+            const char *category;
+            int64_t start;
+            int64_t end;
+        };
+
+        /// Single-writer ring of completed spans. Buffers outlive their threads so
+        /// spans from finished threads still show up in a dump.
+        struct ThreadBuffer {
+            uint32_t tid = 0;
+            std::string name;
+            std::vector<TraceEvent> events;
+            std::atomic<uint64_t> head{0};
+        };
+
+        std::mutex &BuffersMutex() {
+            static std::mutex mutex;
+            return mutex;
+        }
+
+        std::vector<std::shared_ptr<ThreadBuffer>> &Buffers() {
+            static std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+            return buffers;
+        }
+
+        /// Kept apart from the buffer so naming a thread costs nothing while tracing is off.
+        thread_local std::string t_name;
+
+        thread_local std::shared_ptr<ThreadBuffer> t_buffer;
+
+        /// Allocates the calling thread's ring on its first recorded span.
+        ThreadBuffer &LocalBuffer() {
+            if (!t_buffer) {
+                t_buffer = std::make_shared<ThreadBuffer>();
+                t_buffer->events.resize(Tracer::BufferSize);
+
+                std::lock_guard<std::mutex> lock(BuffersMutex());
+                t_buffer->tid = static_cast<uint32_t>(Buffers().size() + 1);
+                t_buffer->name = t_name.empty() ? "thread " + std::to_string(t_buffer->tid) : t_name;
+                Buffers().push_back(t_buffer);
+            }
+            return *t_buffer;
+        }
+
+        thread_local std::atomic<const char *> *t_context = nullptr;
+
+        void WriteEscaped(std::ostream &os, const std::string &value) {
+            for (char c : value) {
+                if (c == '"' || c == '\\') {
+                    os << '\\' << c;
+                } else if (static_cast<unsigned char>(c) < 0x20) {
+                    os << ' ';
+                } else {
+                    os << c;
+                }
+            }
+        }
+    }
+
+    std::atomic<bool> Tracer::s_enabled(false);
+
+    void Tracer::Enable(bool enabled) {
+        s_enabled.store(enabled, std::memory_order_relaxed);
+    }
+
+    void Tracer::SetThreadName(const std::string &name) {
+        t_name = name;
+        if (t_buffer) {
+            std::lock_guard<std::mutex> lock(BuffersMutex());
+            t_buffer->name = name;
+        }
+    }
+
+    void Tracer::Record(const char *name, const char *category, int64_t startNs, int64_t endNs) {
+        if (!Enabled()) {
+            return;
+        }
+        ThreadBuffer &buffer = LocalBuffer();
+        uint64_t head = buffer.head.load(std::memory_order_relaxed);
+        buffer.events[head % BufferSize] = TraceEvent{name, category, startNs, endNs};
+        buffer.head.store(head + 1, std::memory_order_release);
+    }
+
+    bool Tracer::Dump(const std::string &fileName) {
+        std::ofstream out(fileName);
+        if (!out) {
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(BuffersMutex());
+        out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+        bool first = true;
+        out << std::fixed << std::setprecision(3);
+        for (const std::shared_ptr<ThreadBuffer> &buffer : Buffers()) {
+            out << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+                << buffer->tid << ",\"args\":{\"name\":\"";
+            WriteEscaped(out, buffer->name);
+            out << "\"}}";
+            first = false;
+
+            // Spans still being written by their thread may be torn; that is
+            // acceptable for a diagnostic dump and keeps recording lock-free.
+            uint64_t head = buffer->head.load(std::memory_order_acquire);
+            uint64_t begin = head > BufferSize ? head - BufferSize : 0;
+            for (uint64_t i = begin; i < head; ++i) {
+                const TraceEvent event = buffer->events[i % BufferSize];
+                if (event.name == nullptr) {
+                    continue;
+                }
+                out << ",\n{\"name\":\"" << event.name << "\",\"cat\":\"" << event.category
+                    << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->tid
+                    << ",\"ts\":" << static_cast<double>(event.start) / 1000.0
+                    << ",\"dur\":" << static_cast<double>(event.end - event.start) / 1000.0 << "}";
+            }
+        }
+        out << "\n]}\n";
+        return static_cast<bool>(out);
+    }
+
+    void Tracer::PublishContext(std::atomic<const char *> *context) {
+        t_context = context;
+    }
+
+    TraceSpan::TraceSpan(const char *name, const char *category)
+            : m_name(name), m_category(category), m_parent(nullptr),
+              m_start(Tracer::Enabled() ? Clock::NowNs() : 0) {
+        if (t_context != nullptr) {
+            m_parent = t_context->load(std::memory_order_relaxed);
+            t_context->store(name, std::memory_order_relaxed);
+        }
+    }
+
+    TraceSpan::~TraceSpan() {
+        if (t_context != nullptr) {
+            t_context->store(m_parent, std::memory_order_relaxed);
+        }
+        if (m_start != 0 && Tracer::Enabled()) {
+            Tracer::Record(m_name, m_category, m_start, Clock::NowNs());
+        }
+    }
+}
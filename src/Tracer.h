@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace AMM {
+
+/// Opt-in span tracer. Each thread records completed spans into its own ring
+/// buffer, allocated on its first span while tracing is enabled, so tracing never
+/// takes a lock on the hot path and costs untraced threads no memory; Dump() writes
+/// the buffers as Chrome trace JSON, which Perfetto and chrome://tracing open.
+/// Span names and categories must be string literals or otherwise outlive the tracer.
+    class Tracer {
+
+    public:
+        /// Spans kept per thread; older spans are overwritten.
+        static const std::size_t BufferSize = 16384;
+
+        static void Enable(bool enabled);
+
+        static bool Enabled() { return s_enabled.load(std::memory_order_relaxed); }
+
+        /// Names the calling thread in the trace. Allocates nothing beyond the name itself.
+        static void SetThreadName(const std::string &name);
+
+        static void Record(const char *name, const char *category, int64_t startNs, int64_t endNs);
+
+        static bool Dump(const std::string &fileName);
+
+        /// Mirrors the name of the calling thread's innermost open span into `context`,
+        /// whether or not tracing is enabled, so another thread can tell what this one
+        /// is doing. Pass nullptr to stop.
+        static void PublishContext(std::atomic<const char *> *context);
+
+    private:
+        static std::atomic<bool> s_enabled;
+    };
+
+/// Records the enclosing scope as a span when tracing is enabled.
+    class TraceSpan {
+
+    public:
+        explicit TraceSpan(const char *name, const char *category = "amm");
+
+        ~TraceSpan();
+
+        TraceSpan(const TraceSpan &) = delete;
+
+        TraceSpan &operator=(const TraceSpan &) = delete;
+
+    private:
+        const char *m_name;
+        const char *m_category;
+        const char *m_parent;
+        int64_t m_start;
+    };
+
+} // namespace AMM
@@ -0,0 +1,194 @@
+#include "BusCapture.h"
+
+#include "amm/BaseLogger.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <thread>
+
+using namespace std;
+
+namespace {
+
+/// Participant standing in for one recorded writer, with a publisher for every topic.
+    class ReplayParticipant : public AMM::ListenerInterface {
+
+    public:
+        explicit ReplayParticipant(const std::string &config) : m_mgr(new AMM::DDSManager<ReplayParticipant>(config)) {
+#define AMM_REPLAY_TOPIC(Topic) m_mgr->Initialize##Topic(); m_mgr->Create##Topic##Publisher();
+            AMM_REPLAY_TOPIC(SimulationControl)
+            AMM_REPLAY_TOPIC(Assessment)
+            AMM_REPLAY_TOPIC(Log)
+            AMM_REPLAY_TOPIC(RenderModification)
+            AMM_REPLAY_TOPIC(PhysiologyModification)
+            AMM_REPLAY_TOPIC(EventRecord)
+            AMM_REPLAY_TOPIC(EventFragment)
+            AMM_REPLAY_TOPIC(Command)
+            AMM_REPLAY_TOPIC(FragmentAmendmentRequest)
+            AMM_REPLAY_TOPIC(OmittedEvent)
+            AMM_REPLAY_TOPIC(OperationalDescription)
+            AMM_REPLAY_TOPIC(ModuleConfiguration)
+            AMM_REPLAY_TOPIC(Status)
+#undef AMM_REPLAY_TOPIC
+        }
+
+        ~ReplayParticipant() {
+            m_mgr->Shutdown();
+        }
+
+        /// Deserializes a recorded sample and publishes it on its topic.
+        bool Publish(AMM::CaptureRecord &record) {
+            switch (record.topic) {
+#define AMM_REPLAY_TOPIC(Topic)                                            \
+                case AMM::TopicId::Topic: {                                \
+                    AMM::Topic sample;                                     \
+                    if (!AMM::DeserializeSample(record.payload, sample)) { \
+                        return false;                                      \
+                    }                                                      \
+                    m_mgr->Write##Topic(sample);                           \
+                    return true;                                           \
+                }
+                AMM_REPLAY_TOPIC(SimulationControl)
+                AMM_REPLAY_TOPIC(Assessment)
+                AMM_REPLAY_TOPIC(Log)
+                AMM_REPLAY_TOPIC(RenderModification)
+                AMM_REPLAY_TOPIC(PhysiologyModification)
+                AMM_REPLAY_TOPIC(EventRecord)
+                AMM_REPLAY_TOPIC(EventFragment)
+                AMM_REPLAY_TOPIC(Command)
+                AMM_REPLAY_TOPIC(FragmentAmendmentRequest)
+                AMM_REPLAY_TOPIC(OmittedEvent)
+                AMM_REPLAY_TOPIC(OperationalDescription)
+                AMM_REPLAY_TOPIC(ModuleConfiguration)
+                AMM_REPLAY_TOPIC(Status)
+#undef AMM_REPLAY_TOPIC
+                default:
+                    return false;
+            }
+        }
+
+    private:
+        AMM::DDSManager<ReplayParticipant> *m_mgr;
+    };
+
+    /// Recorded writer a sample is replayed from; every sample shares one with -1.
+    std::string WriterKey(const AMM::CaptureRecord &record, bool singleParticipant) {
+        if (singleParticipant) {
+            return std::string();
+        }
+        return std::string(reinterpret_cast<const char *>(record.writer), sizeof(record.writer));
+    }
+
+    void ShowUsage(const std::string &name) {
+        cerr << "Usage: " << name << " <capture file> <option(s)>"
+             << "\nOptions:\n"
+             << "\t-x <speed>|max\t\tReplay speed relative to the recording (default 1)\n"
+             << "\t-l <count>\t\tReplay the capture this many times (default 1)\n"
+             << "\t-1\t\t\tPublish everything from a single participant instead of one per recorded writer\n"
+             << "\t-c <file>\t\tParticipant profile (default config/amm_load_generator.xml)\n"
+             << "\t-h,--help\t\tShow this help message\n"
+             << endl;
+    }
+}
+
+/// Republishes a capture recorded with amm_module_manager -r onto the local domain,
+/// preserving the recorded spacing between samples (scaled by -x) unless run at max speed.
+int main(int argc, char *argv[]) {
+    static plog::ColorConsoleAppender <plog::TxtFormatter> consoleAppender;
+    plog::init(plog::info, &consoleAppender);
+
+    string captureFile;
+    string config = "config/amm_load_generator.xml";
+    double speed = 1.0;
+    int loops = 1;
+    bool singleParticipant = false;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+
+        if ((arg == "-h") || (arg == "--help")) {
+            ShowUsage(argv[0]);
+            return 0;
+        }
+
+        if (arg == "-x" && i + 1 < argc) {
+            string value = argv[++i];
+            speed = value == "max" ? 0.0 : atof(value.c_str());
+        } else if (arg == "-l" && i + 1 < argc) {
+            loops = atoi(argv[++i]);
+        } else if (arg == "-c" && i + 1 < argc) {
+            config = argv[++i];
+        } else if (arg == "-1") {
+            singleParticipant = true;
+        } else if (captureFile.empty() && arg[0] != '-') {
+            captureFile = arg;
+        }
+    }
+    if (captureFile.empty() || speed < 0.0 || loops < 1) {
+        ShowUsage(argv[0]);
+        return 1;
+    }
+
+    // Writers are discovered lazily, so one participant per recorded writer keeps modules apart.
+    // All of them are created, and given time to match, before the replay clock starts.
+    std::map<std::string, std::unique_ptr<ReplayParticipant>> participants;
+    {
+        AMM::CaptureReader reader;
+        if (!reader.Open(captureFile)) {
+            return 1;
+        }
+        AMM::CaptureRecord record;
+        while (reader.Next(record)) {
+            std::unique_ptr<ReplayParticipant> &participant = participants[WriterKey(record, singleParticipant)];
+            if (!participant) {
+                participant.reset(new ReplayParticipant(config));
+            }
+        }
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(250));
+
+    uint64_t published = 0;
+    uint64_t failed = 0;
+    const auto started = std::chrono::steady_clock::now();
+
+    for (int loop = 0; loop < loops; ++loop) {
+        AMM::CaptureReader reader;
+        if (!reader.Open(captureFile)) {
+            return 1;
+        }
+
+        AMM::CaptureRecord record;
+        int64_t firstReceive = -1;
+        const auto loopStart = std::chrono::steady_clock::now();
+        while (reader.Next(record)) {
+            const auto participant = participants.find(WriterKey(record, singleParticipant));
+            if (participant == participants.end()) {
+                // Only if the file grew since the first pass.
+                ++failed;
+                continue;
+            }
+
+            if (firstReceive < 0) {
+                firstReceive = record.receive;
+            }
+            if (speed > 0.0) {
+                const auto offset = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                        std::chrono::nanoseconds(static_cast<int64_t>((record.receive - firstReceive) / speed)));
+                std::this_thread::sleep_until(loopStart + offset);
+            }
+
+            if (participant->second->Publish(record)) {
+                ++published;
+            } else {
+                ++failed;
+            }
+        }
+        LOG_INFO << "Replayed pass " << loop + 1 << " of " << loops;
+    }
+
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    LOG_INFO << "Published " << published << " samples from " << participants.size() << " participants in "
+             << elapsed << "s (" << (elapsed > 0 ? published / elapsed : 0) << "/s), " << failed << " failed";
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,368 @@
+#include "amm_std.h"
+
+#include "amm/BaseLogger.h"
+
+#include "thirdparty/sqlite_modern_cpp.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <thread>
+
+using namespace std;
+using namespace sqlite;
+
+namespace {
+    enum Stream {
+        StatusStream = 0,
+        EventStream,
+        LogStream,
+        RenderStream,
+        StreamCount
+    };
+
+    const char *StreamName(int stream) {
+        static const char *names[StreamCount] = {"Status", "EventRecord", "Log", "RenderModification"};
+        return names[stream];
+    }
+
+    struct Options {
+        int modules = 4;
+        string profile = "soak";
+        int seconds = 60;
+        int steps = 5;
+        int settle = 3;
+        double rates[StreamCount] = {1.0, 5.0, 2.0, 50.0};
+        string config = "config/amm_load_generator.xml";
+        string database = "amm.db";
+    };
+
+    /// Scales every module's publish rates; the ramp profile raises it step by step.
+    std::atomic<double> rateScale(1.0);
+    std::atomic<bool> running(true);
+
+    uint64_t NowMs() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count());
+    }
+
+/// One simulated module: its own participant, publishing each stream at a fixed rate.
+    class FakeModule : public AMM::ListenerInterface {
+
+    public:
+        FakeModule(const std::string &name, const Options &options)
+                : m_name(name), m_options(options), m_mgr(new AMM::DDSManager<FakeModule>(options.config)) {
+            m_mgr->InitializeOperationalDescription();
+            m_mgr->InitializeStatus();
+            m_mgr->InitializeEventRecord();
+            m_mgr->InitializeLog();
+            m_mgr->InitializeRenderModification();
+
+            m_mgr->CreateOperationalDescriptionPublisher();
+            m_mgr->CreateStatusPublisher();
+            m_mgr->CreateEventRecordPublisher();
+            m_mgr->CreateLogPublisher();
+            m_mgr->CreateRenderModificationPublisher();
+
+            m_uuid.id(m_mgr->GenerateUuidString());
+            for (std::atomic<uint64_t> &count : m_published) {
+                count = 0;
+            }
+        }
+
+        ~FakeModule() {
+            if (m_thread.joinable()) {
+                m_thread.join();
+            }
+            m_mgr->Shutdown();
+        }
+
+        void Start() {
+            m_thread = std::thread(&FakeModule::Run, this);
+        }
+
+        void Join() {
+            if (m_thread.joinable()) {
+                m_thread.join();
+            }
+        }
+
+        uint64_t Published(int stream) const { return m_published[stream].load(std::memory_order_relaxed); }
+
+    private:
+        void Announce() {
+            AMM::OperationalDescription od;
+            od.name(m_name);
+            od.model("Load Generator");
+            od.manufacturer("AMM");
+            od.serial_number(m_uuid.id());
+            od.module_id(m_uuid);
+            od.module_version("1.0");
+            od.description("Synthetic module publishing at configured rates");
+            m_mgr->WriteOperationalDescription(od);
+        }
+
+        void Publish(int stream, uint64_t seq) {
+            switch (stream) {
+                case StatusStream: {
+                    AMM::Status status;
+                    status.module_id(m_uuid);
+                    status.module_name(m_name);
+                    status.capability("load_generator");
+                    status.value(AMM::StatusValue::OPERATIONAL);
+                    status.message("heartbeat " + std::to_string(seq));
+                    status.timestamp(NowMs());
+                    m_mgr->WriteStatus(status);
+                    break;
+                }
+                case EventStream: {
+                    AMM::EventRecord record;
+                    AMM::UUID id;
+                    id.id(m_mgr->GenerateUuidString());
+                    record.id(id);
+                    record.timestamp(NowMs());
+                    record.type("LOAD_GENERATOR_EVENT");
+                    AMM::FMA_Location location;
+                    location.name("right_forearm");
+                    location.FMAID("9740");
+                    record.location(location);
+                    record.data("<data seq=\"" + std::to_string(seq) + "\"/>");
+                    m_mgr->WriteEventRecord(record);
+                    break;
+                }
+                case LogStream: {
+                    AMM::Log log;
+                    log.module_id(m_uuid);
+                    log.level(AMM::LogLevel::L_INFO);
+                    log.message(m_name + " log line " + std::to_string(seq));
+                    log.timestamp(NowMs());
+                    m_mgr->WriteLog(log);
+                    break;
+                }
+                case RenderStream: {
+                    AMM::RenderModification render;
+                    AMM::UUID id;
+                    id.id(m_mgr->GenerateUuidString());
+                    render.event_id(id);
+                    render.type("LOAD_GENERATOR_RENDER");
+                    render.data("<RenderModification type=\"LOAD_GENERATOR_RENDER\" seq=\"" +
+                                std::to_string(seq) + "\"/>");
+                    m_mgr->WriteRenderModification(render);
+                    break;
+                }
+                default:
+                    return;
+            }
+            m_published[stream].fetch_add(1, std::memory_order_relaxed);
+        }
+
+        /// Publishes each stream on its own schedule; a stream that falls behind catches up back to back.
+        void Run() {
+            typedef std::chrono::steady_clock clock;
+            Announce();
+            clock::time_point next[StreamCount];
+            for (clock::time_point &time : next) {
+                time = clock::now();
+            }
+            uint64_t seq = 0;
+            while (running.load()) {
+                int due = 0;
+                for (int stream = 1; stream < StreamCount; ++stream) {
+                    if (next[stream] < next[due]) {
+                        due = stream;
+                    }
+                }
+                std::this_thread::sleep_until(std::min(next[due], clock::now() + std::chrono::milliseconds(100)));
+                if (clock::now() < next[due]) {
+                    continue;
+                }
+
+                Publish(due, seq++);
+                const double rate = m_options.rates[due] * rateScale.load();
+                next[due] += rate > 0 ? std::chrono::duration_cast<clock::duration>(
+                        std::chrono::duration<double>(1.0 / rate)) : std::chrono::hours(24);
+            }
+        }
+
+        const std::string m_name;
+        const Options &m_options;
+        AMM::DDSManager<FakeModule> *m_mgr;
+        AMM::UUID m_uuid;
+        std::atomic<uint64_t> m_published[StreamCount];
+        std::thread m_thread;
+    };
+
+    uint64_t TotalPublished(const std::vector<std::unique_ptr<FakeModule>> &modules, int stream) {
+        uint64_t total = 0;
+        for (const std::unique_ptr<FakeModule> &module : modules) {
+            total += module->Published(stream);
+        }
+        return total;
+    }
+
+    void ShowUsage(const std::string &name) {
+        cerr << "Usage: " << name << " <option(s)>"
+             << "\nOptions:\n"
+             << "\t-n <count>\t\tSimulated modules (default 4)\n"
+             << "\t-p ramp|soak\t\tRamp rates up step by step, or hold them (default soak)\n"
+             << "\t-t <seconds>\t\tSoak duration, or duration of each ramp step (default 60)\n"
+             << "\t-s <steps>\t\tRamp steps; step k publishes at k times the base rates (default 5)\n"
+             << "\t-r <s,e,l,r>\t\tBase rates in Hz per module for Status, EventRecord, Log and\n"
+             << "\t\t\t\tRenderModification (default 1,5,2,50)\n"
+             << "\t-w <seconds>\t\tTime to let the manager commit before reading back (default 3)\n"
+             << "\t-c <file>\t\tParticipant profile (default config/amm_load_generator.xml)\n"
+             << "\t-db <file>\t\tManager database to read back (default amm.db)\n"
+             << "\t-h,--help\t\tShow this help message\n"
+             << endl;
+    }
+
+    bool ParseRates(const std::string &value, double *rates) {
+        std::istringstream in(value);
+        std::string field;
+        for (int stream = 0; stream < StreamCount; ++stream) {
+            if (!std::getline(in, field, ',')) {
+                return false;
+            }
+            rates[stream] = atof(field.c_str());
+        }
+        return true;
+    }
+
+    /// Rows the manager stored for this run's modules, keyed the way the streams are.
+    void CountPersisted(const Options &options, const std::string &namePattern, uint64_t *persisted) {
+        try {
+            database db(options.database);
+            const std::string modules = "(select module_key from modules where module_name like ?)";
+            const std::string moduleIds = "(select module_id from modules where module_name like ?)";
+
+            db << "select topic, count(*) from events where module_key in " + modules + " group by topic;"
+               << namePattern
+               >> [&](const std::string &topic, long long count) {
+                   for (int stream = 0; stream < StreamCount; ++stream) {
+                       if (topic == StreamName(stream)) {
+                           persisted[stream] = static_cast<uint64_t>(count);
+                       }
+                   }
+               };
+            long long count = 0;
+            db << "select count(*) from logs where module_id in " + moduleIds + ";" << namePattern >> count;
+            persisted[LogStream] = static_cast<uint64_t>(count);
+            db << "select count(*) from module_status where module_id in " + moduleIds + ";" << namePattern >> count;
+            persisted[StatusStream] = static_cast<uint64_t>(count);
+        } catch (exception &e) {
+            LOG_ERROR << "Unable to read back " << options.database << ": " << e.what();
+        }
+    }
+}
+
+/// Simulates a room full of modules publishing at configurable rates, then reads back
+/// amm.db to show how much of the traffic the Module Manager persisted.
+int main(int argc, char *argv[]) {
+    static plog::ColorConsoleAppender <plog::TxtFormatter> consoleAppender;
+    plog::init(plog::info, &consoleAppender);
+
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+
+        if ((arg == "-h") || (arg == "--help")) {
+            ShowUsage(argv[0]);
+            return 0;
+        }
+
+        if (i + 1 >= argc) {
+            continue;
+        }
+        if (arg == "-n") {
+            options.modules = atoi(argv[++i]);
+        } else if (arg == "-p") {
+            options.profile = argv[++i];
+        } else if (arg == "-t") {
+            options.seconds = atoi(argv[++i]);
+        } else if (arg == "-s") {
+            options.steps = atoi(argv[++i]);
+        } else if (arg == "-w") {
+            options.settle = atoi(argv[++i]);
+        } else if (arg == "-r") {
+            if (!ParseRates(argv[++i], options.rates)) {
+                ShowUsage(argv[0]);
+                return 1;
+            }
+        } else if (arg == "-c") {
+            options.config = argv[++i];
+        } else if (arg == "-db") {
+            options.database = argv[++i];
+        }
+    }
+    const bool ramp = options.profile == "ramp";
+    if (options.modules < 1 || options.seconds < 1 || (!ramp && options.profile != "soak") ||
+        (ramp && options.steps < 1)) {
+        ShowUsage(argv[0]);
+        return 1;
+    }
+
+    // Module names carry a run id so the read-back only counts this run's rows.
+    const std::string runId = std::to_string(NowMs());
+    LOG_INFO << "Starting " << options.modules << " modules, run " << runId;
+    std::vector<std::unique_ptr<FakeModule>> modules;
+    for (int i = 0; i < options.modules; ++i) {
+        modules.emplace_back(new FakeModule("loadgen-" + runId + "-" + std::to_string(i), options));
+    }
+    // Give the manager time to match the new writers before traffic starts.
+    std::this_thread::sleep_for(std::chrono::seconds(2));
+
+    rateScale = 1.0;
+    for (std::unique_ptr<FakeModule> &module : modules) {
+        module->Start();
+    }
+
+    cout << left << setw(8) << "step" << right << setw(8) << "scale";
+    for (int stream = 0; stream < StreamCount; ++stream) {
+        cout << setw(20) << (std::string(StreamName(stream)) + "/s");
+    }
+    cout << endl;
+
+    const int steps = ramp ? options.steps : 1;
+    for (int step = 1; step <= steps; ++step) {
+        rateScale = ramp ? static_cast<double>(step) : 1.0;
+        uint64_t before[StreamCount];
+        for (int stream = 0; stream < StreamCount; ++stream) {
+            before[stream] = TotalPublished(modules, stream);
+        }
+        const auto start = std::chrono::steady_clock::now();
+        std::this_thread::sleep_for(std::chrono::seconds(options.seconds));
+        const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        cout << left << setw(8) << step << right << setw(8) << rateScale.load() << fixed << setprecision(1);
+        for (int stream = 0; stream < StreamCount; ++stream) {
+            cout << setw(20) << (TotalPublished(modules, stream) - before[stream]) / elapsed;
+        }
+        cout << endl;
+    }
+
+    running = false;
+    for (std::unique_ptr<FakeModule> &module : modules) {
+        module->Join();
+    }
+
+    LOG_INFO << "Waiting " << options.settle << "s for the manager to commit";
+    std::this_thread::sleep_for(std::chrono::seconds(options.settle));
+
+    uint64_t persisted[StreamCount] = {};
+    CountPersisted(options, "loadgen-" + runId + "-%", persisted);
+
+    cout << endl << left << setw(20) << "stream" << right << setw(12) << "published" << setw(12) << "persisted"
+         << setw(10) << "lost %" << endl;
+    for (int stream = 0; stream < StreamCount; ++stream) {
+        const uint64_t published = TotalPublished(modules, stream);
+        const double lost = published == 0 ? 0.0 :
+                            100.0 * (static_cast<double>(published) - static_cast<double>(persisted[stream])) /
+                            static_cast<double>(published);
+        cout << left << setw(20) << StreamName(stream) << right << setw(12) << published
+             << setw(12) << persisted[stream] << setw(10) << setprecision(2) << lost << endl;
+    }
+
+    modules.clear();
+    return 0;
+}
@@ -0,0 +1,137 @@
+#include "ScenarioBundle.h"
+#include "ScenarioCache.h"
+
+#include "amm/BaseLogger.h"
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+    void ShowUsage(const std::string &name) {
+        cerr << "Usage: " << name << " <option(s)> [directory | scenario.xml ...]"
+             << "\nOptions:\n"
+             << "\t-o <file>\t\tBundle to write (default <directory>.bundle, static/scenarios.bundle)\n"
+             << "\t-f\t\t\tWrite the bundle even if scenarios have problems; unparseable files still fail\n"
+             << "\t-h,--help\t\tShow this help message\n"
+             << endl;
+    }
+
+    std::string Stem(const std::string &fileName) {
+        const std::size_t slash = fileName.find_last_of("/\\");
+        std::string stem = slash == std::string::npos ? fileName : fileName.substr(slash + 1);
+        const std::size_t dot = stem.rfind('.');
+        return dot == std::string::npos ? stem : stem.substr(0, dot);
+    }
+
+    bool EndsWith(const std::string &value, const std::string &suffix) {
+        return value.size() >= suffix.size() &&
+               value.compare(value.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+}
+
+/// Validates scenario XML and compiles it into a bundle the manager maps at startup
+/// instead of parsing the scenario directory.
+int main(int argc, char *argv[]) {
+    // Problems are printed below, per file; the log only adds why a file does not parse.
+    static plog::ColorConsoleAppender <plog::TxtFormatter> consoleAppender;
+    plog::init(plog::error, &consoleAppender);
+
+    string output;
+    bool force = false;
+    vector<string> inputs;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+
+        if ((arg == "-h") || (arg == "--help")) {
+            ShowUsage(argv[0]);
+            return 0;
+        }
+
+        if (arg == "-o" && i + 1 < argc) {
+            output = argv[++i];
+        } else if (arg == "-f") {
+            force = true;
+        } else if (arg[0] != '-') {
+            inputs.push_back(arg);
+        } else {
+            ShowUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    // A single directory is compiled as the manager would preload it.
+    vector<pair<string, string>> files;
+    if (inputs.empty() || (inputs.size() == 1 && !EndsWith(inputs[0], ".xml"))) {
+        AMM::ScenarioCache directory(inputs.empty() ? "static/scenarios" : inputs[0]);
+        if (output.empty()) {
+            output = directory.BundleFile();
+        }
+        for (const string &name : AMM::ScenarioCache::List(directory.Directory())) {
+            files.emplace_back(directory.Directory() + "/" + name + ".xml", name);
+        }
+    } else {
+        for (const string &input : inputs) {
+            files.emplace_back(input, Stem(input));
+        }
+    }
+    if (output.empty()) {
+        cerr << "-o is required when compiling individual files" << endl;
+        return 1;
+    }
+    if (files.empty()) {
+        cerr << "No scenarios to compile" << endl;
+        return 1;
+    }
+
+    vector<shared_ptr<const AMM::CompiledScenario>> scenarios;
+    size_t capabilities = 0;
+    int failed = 0;
+    int withProblems = 0;
+    for (const auto &file : files) {
+        vector<string> problems;
+        shared_ptr<AMM::CompiledScenario> scenario = AMM::ScenarioCache::Compile(file.first, file.second, &problems);
+        if (!scenario) {
+            cerr << file.first << ": does not parse" << endl;
+            ++failed;
+            continue;
+        }
+        for (const string &problem : problems) {
+            cerr << file.first << ": " << problem << endl;
+        }
+        if (!problems.empty()) {
+            ++withProblems;
+        }
+        for (const auto &other : scenarios) {
+            if (other->name == scenario->name) {
+                cerr << file.first << ": another file is also named " << scenario->name << endl;
+                ++failed;
+            }
+        }
+        capabilities += scenario->capabilities.size();
+        scenarios.push_back(scenario);
+    }
+    if (failed > 0 || (withProblems > 0 && !force)) {
+        cerr << failed << " scenarios failed and " << withProblems << " have problems; " << output
+             << " was not written" << (failed == 0 ? " (use -f to write it anyway)" : "") << endl;
+        return 1;
+    }
+
+    string error;
+    if (!AMM::ScenarioBundle::Write(output, scenarios, error)) {
+        cerr << error << endl;
+        return 1;
+    }
+    AMM::ScenarioBundle bundle;
+    if (!bundle.Open(output) || bundle.Size() != scenarios.size()) {
+        cerr << output << " does not read back" << endl;
+        return 1;
+    }
+    cout << "Compiled " << scenarios.size() << " scenarios and " << capabilities << " capabilities into " << output
+         << endl;
+    return 0;
+}
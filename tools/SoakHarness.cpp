@@ -0,0 +1,366 @@
+#include <dirent.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace {
+    struct Options {
+        int minutes = 60;
+        int interval = 60;
+        double warmup = 0.1;
+        string binDir;
+        string metricsFile = "soak_metrics.prom";
+        string csvFile = "soak.csv";
+        vector<string> workload;
+
+        /// Largest acceptable growth per hour, fitted over the samples after warm-up.
+        double maxRssMbPerHour = 5;
+        double maxHeapMbPerHour = 5;
+        double maxFdsPerHour = 1;
+        double maxP99MsPerHour = 1;
+        /// The workload's module set is fixed, so known modules should level off once it has started.
+        double maxModulesPerHour = 1;
+    };
+
+    struct Sample {
+        double hours = 0;
+        double rssMb = 0;
+        double heapMb = 0;
+        double fds = 0;
+        double dbMb = 0;
+        double modules = 0;
+        double listenerP50Ms = 0;
+        double listenerP99Ms = 0;
+        double commitP99Ms = 0;
+    };
+
+    /// Prometheus text file: series (name plus labels) to value.
+    typedef map<string, double> Metrics;
+
+    Metrics ReadMetrics(const string &fileName) {
+        Metrics metrics;
+        ifstream in(fileName);
+        string line;
+        while (getline(in, line)) {
+            if (line.empty() || line[0] == '#') {
+                continue;
+            }
+            const size_t space = line.rfind(' ');
+            if (space != string::npos) {
+                metrics[line.substr(0, space)] = atof(line.c_str() + space + 1);
+            }
+        }
+        return metrics;
+    }
+
+    /// Cumulative bucket counts of a histogram family, summed over every label set.
+    map<double, double> Buckets(const Metrics &metrics, const string &family) {
+        map<double, double> buckets;
+        const string prefix = family + "_bucket{";
+        for (auto it = metrics.lower_bound(prefix);
+             it != metrics.end() && it->first.compare(0, prefix.size(), prefix) == 0; ++it) {
+            const size_t le = it->first.find("le=\"");
+            if (le == string::npos) {
+                continue;
+            }
+            const string bound = it->first.substr(le + 4, it->first.find('"', le + 4) - le - 4);
+            buckets[bound == "+Inf" ? INFINITY : atof(bound.c_str())] += it->second;
+        }
+        return buckets;
+    }
+
+    /// Quantile of the observations made between two scrapes, interpolated within its bucket.
+    double IntervalQuantile(const map<double, double> &now, const map<double, double> &before, double quantile) {
+        if (now.empty()) {
+            return 0;
+        }
+        auto countAt = [&](const map<double, double>::value_type &bucket) {
+            auto prior = before.find(bucket.first);
+            return bucket.second - (prior == before.end() ? 0 : prior->second);
+        };
+        const double total = countAt(*now.rbegin());
+        if (total <= 0) {
+            return 0;
+        }
+        const double rank = quantile * total;
+        double lowerBound = 0;
+        double lowerCount = 0;
+        for (const auto &bucket : now) {
+            const double count = countAt(bucket);
+            if (count >= rank) {
+                if (std::isinf(bucket.first)) {
+                    return lowerBound;
+                }
+                const double inBucket = count - lowerCount;
+                return lowerBound + (bucket.first - lowerBound) * (inBucket > 0 ? (rank - lowerCount) / inBucket : 1);
+            }
+            lowerBound = bucket.first;
+            lowerCount = count;
+        }
+        return lowerBound;
+    }
+
+    double ResidentMb(pid_t pid) {
+        ifstream statm("/proc/" + to_string(pid) + "/statm");
+        long pages = 0;
+        statm >> pages >> pages;
+        return static_cast<double>(pages) * static_cast<double>(sysconf(_SC_PAGESIZE)) / (1024 * 1024);
+    }
+
+    double OpenFds(pid_t pid) {
+        DIR *dir = opendir(("/proc/" + to_string(pid) + "/fd").c_str());
+        if (dir == nullptr) {
+            return 0;
+        }
+        double count = 0;
+        while (dirent *entry = readdir(dir)) {
+            if (entry->d_name[0] != '.') {
+                ++count;
+            }
+        }
+        closedir(dir);
+        return count;
+    }
+
+    double FileMb(const string &fileName) {
+        struct stat info;
+        return stat(fileName.c_str(), &info) == 0 ? static_cast<double>(info.st_size) / (1024 * 1024) : 0;
+    }
+
+    pid_t Launch(const vector<string> &command) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            vector<char *> args;
+            for (const string &arg : command) {
+                args.push_back(const_cast<char *>(arg.c_str()));
+            }
+            args.push_back(nullptr);
+            execv(args[0], args.data());
+            cerr << "Unable to start " << command[0] << endl;
+            _exit(127);
+        }
+        return pid;
+    }
+
+    bool Running(pid_t pid) {
+        return waitpid(pid, nullptr, WNOHANG) == 0;
+    }
+
+    void Terminate(pid_t pid) {
+        if (pid <= 0 || !Running(pid)) {
+            return;
+        }
+        kill(pid, SIGTERM);
+        for (int i = 0; i < 100 && Running(pid); ++i) {
+            this_thread::sleep_for(chrono::milliseconds(100));
+        }
+        if (Running(pid)) {
+            kill(pid, SIGKILL);
+            waitpid(pid, nullptr, 0);
+        }
+    }
+
+    /// Least-squares slope of value against time, in units per hour.
+    double Slope(const vector<Sample> &samples, double Sample::*field, size_t first) {
+        const size_t n = samples.size() - first;
+        if (n < 2) {
+            return 0;
+        }
+        double meanX = 0;
+        double meanY = 0;
+        for (size_t i = first; i < samples.size(); ++i) {
+            meanX += samples[i].hours;
+            meanY += samples[i].*field;
+        }
+        meanX /= n;
+        meanY /= n;
+        double covariance = 0;
+        double variance = 0;
+        for (size_t i = first; i < samples.size(); ++i) {
+            covariance += (samples[i].hours - meanX) * (samples[i].*field - meanY);
+            variance += (samples[i].hours - meanX) * (samples[i].hours - meanX);
+        }
+        return variance > 0 ? covariance / variance : 0;
+    }
+
+    void ShowUsage(const string &name) {
+        cerr << "Usage: " << name << " <option(s)> [-- <workload command>]"
+             << "\nRuns amm_module_manager (from this program's directory, or -b) under a workload and\n"
+             << "fails if memory, descriptors, known modules or latency keep growing. The default\n"
+             << "workload is amm_load_generator -p soak for the whole run.\n"
+             << "\nOptions:\n"
+             << "\t-t <minutes>\t\tRun length (default 60)\n"
+             << "\t-i <seconds>\t\tSampling interval (default 60)\n"
+             << "\t-b <dir>\t\tDirectory holding the AMM executables (default: this program's directory)\n"
+             << "\t-o <file>\t\tCSV of every sample (default soak.csv)\n"
+             << "\t--max-rss <MB/h>\t\tResident memory growth allowed (default 5)\n"
+             << "\t--max-heap <MB/h>\t\tHeap growth allowed (default 5)\n"
+             << "\t--max-fds <n/h>\t\tDescriptor growth allowed (default 1)\n"
+             << "\t--max-p99 <ms/h>\t\tListener p99 growth allowed (default 1)\n"
+             << "\t--max-modules <n/h>\tKnown module growth allowed (default 1)\n"
+             << "\t-h,--help\t\tShow this help message\n"
+             << endl;
+    }
+}
+
+/// Soak test: samples the manager's resource use and latency at intervals while a workload
+/// runs, then fits a trend to each and fails if any grows faster than its threshold.
+int main(int argc, char *argv[]) {
+    Options options;
+    const string self = argv[0];
+    options.binDir = self.find('/') == string::npos ? "." : self.substr(0, self.rfind('/'));
+
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+
+        if ((arg == "-h") || (arg == "--help")) {
+            ShowUsage(argv[0]);
+            return 0;
+        }
+        if (arg == "--") {
+            options.workload.assign(argv + i + 1, argv + argc);
+            break;
+        }
+        if (i + 1 >= argc) {
+            continue;
+        }
+        if (arg == "-t") {
+            options.minutes = atoi(argv[++i]);
+        } else if (arg == "-i") {
+            options.interval = atoi(argv[++i]);
+        } else if (arg == "-b") {
+            options.binDir = argv[++i];
+        } else if (arg == "-o") {
+            options.csvFile = argv[++i];
+        } else if (arg == "--max-rss") {
+            options.maxRssMbPerHour = atof(argv[++i]);
+        } else if (arg == "--max-heap") {
+            options.maxHeapMbPerHour = atof(argv[++i]);
+        } else if (arg == "--max-fds") {
+            options.maxFdsPerHour = atof(argv[++i]);
+        } else if (arg == "--max-p99") {
+            options.maxP99MsPerHour = atof(argv[++i]);
+        } else if (arg == "--max-modules") {
+            options.maxModulesPerHour = atof(argv[++i]);
+        }
+    }
+    if (options.minutes < 1 || options.interval < 1) {
+        ShowUsage(argv[0]);
+        return 1;
+    }
+    if (options.workload.empty()) {
+        options.workload = {options.binDir + "/amm_load_generator", "-p", "soak", "-n", "8",
+                            "-t", to_string(options.minutes * 60)};
+    }
+
+    remove(options.metricsFile.c_str());
+    const pid_t manager = Launch({options.binDir + "/amm_module_manager", "-a", "-m", options.metricsFile});
+    this_thread::sleep_for(chrono::seconds(5));
+    const pid_t workload = Launch(options.workload);
+
+    ofstream csv(options.csvFile);
+    csv << "hours,rss_mb,heap_mb,fds,db_mb,modules,listener_p50_ms,listener_p99_ms,commit_p99_ms" << endl;
+    cout << setw(8) << "hours" << setw(10) << "rss MB" << setw(10) << "heap MB" << setw(8) << "fds"
+         << setw(10) << "db MB" << setw(9) << "modules" << setw(12) << "listen p99" << setw(12) << "commit p99"
+         << endl;
+
+    vector<Sample> samples;
+    Metrics previous;
+    bool managerDied = false;
+    const auto start = chrono::steady_clock::now();
+    const auto end = start + chrono::minutes(options.minutes);
+    while (chrono::steady_clock::now() < end) {
+        this_thread::sleep_for(chrono::seconds(options.interval));
+        if (!Running(manager)) {
+            managerDied = true;
+            break;
+        }
+
+        const Metrics metrics = ReadMetrics(options.metricsFile);
+        auto metric = [&](const string &series) {
+            auto it = metrics.find(series);
+            return it == metrics.end() ? 0.0 : it->second;
+        };
+        const map<double, double> listener = Buckets(metrics, "amm_listener_duration_seconds");
+        const map<double, double> commit = Buckets(metrics, "amm_event_commit_duration_seconds");
+
+        Sample sample;
+        sample.hours = chrono::duration<double, ratio<3600>>(chrono::steady_clock::now() - start).count();
+        sample.rssMb = ResidentMb(manager);
+        sample.heapMb = metric("amm_heap_in_use_bytes") / (1024 * 1024);
+        sample.fds = OpenFds(manager);
+        sample.dbMb = FileMb("amm.db") + FileMb("amm.db-wal");
+        sample.modules = metric("amm_modules_known");
+        const map<double, double> listenerBefore = Buckets(previous, "amm_listener_duration_seconds");
+        const map<double, double> commitBefore = Buckets(previous, "amm_event_commit_duration_seconds");
+        sample.listenerP50Ms = IntervalQuantile(listener, listenerBefore, 0.5) * 1e3;
+        sample.listenerP99Ms = IntervalQuantile(listener, listenerBefore, 0.99) * 1e3;
+        sample.commitP99Ms = IntervalQuantile(commit, commitBefore, 0.99) * 1e3;
+        previous = metrics;
+        samples.push_back(sample);
+
+        csv << sample.hours << ',' << sample.rssMb << ',' << sample.heapMb << ',' << sample.fds << ','
+            << sample.dbMb << ',' << sample.modules << ',' << sample.listenerP50Ms << ','
+            << sample.listenerP99Ms << ',' << sample.commitP99Ms << endl;
+        cout << fixed << setprecision(2) << setw(8) << sample.hours << setw(10) << sample.rssMb
+             << setw(10) << sample.heapMb << setw(8) << setprecision(0) << sample.fds << setprecision(2)
+             << setw(10) << sample.dbMb << setw(9) << setprecision(0) << sample.modules << setprecision(3)
+             << setw(12) << sample.listenerP99Ms << setw(12) << sample.commitP99Ms << endl;
+    }
+
+    Terminate(workload);
+    Terminate(manager);
+
+    if (managerDied) {
+        cout << "FAIL: amm_module_manager exited during the soak" << endl;
+        return 1;
+    }
+
+    // The first samples include startup allocation and cache warm-up.
+    const size_t first = static_cast<size_t>(samples.size() * options.warmup);
+    struct Check {
+        const char *name;
+        double Sample::*field;
+        double limit;
+        const char *unit;
+    };
+    const Check checks[] = {
+            {"resident memory", &Sample::rssMb,         options.maxRssMbPerHour,   "MB/h"},
+            {"heap in use",     &Sample::heapMb,        options.maxHeapMbPerHour,  "MB/h"},
+            {"open fds",        &Sample::fds,           options.maxFdsPerHour,     "/h"},
+            {"listener p99",    &Sample::listenerP99Ms, options.maxP99MsPerHour,   "ms/h"},
+            {"database size",   &Sample::dbMb,          -1,                        "MB/h"},
+            {"known modules",   &Sample::modules,       options.maxModulesPerHour, "/h"},
+    };
+
+    bool failed = false;
+    cout << endl;
+    for (const Check &check : checks) {
+        const double slope = Slope(samples, check.field, first);
+        const bool over = check.limit >= 0 && slope > check.limit;
+        failed = failed || over;
+        cout << (over ? "FAIL " : "ok   ") << left << setw(18) << check.name << right << setprecision(3)
+             << setw(10) << slope << " " << check.unit;
+        if (check.limit >= 0) {
+            cout << " (limit " << check.limit << ")";
+        }
+        cout << endl;
+    }
+    return failed ? 1 : 0;
+}
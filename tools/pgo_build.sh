@@ -0,0 +1,61 @@
+#!/bin/sh
+# Builds amm_module_manager with profile-guided optimization:
+#   1. an instrumented build (AMM_PGO=GENERATE),
+#   2. a training run on the offline ingest benchmark and, given a capture, the manager fed by amm_bus_replay,
+#   3. a rebuild of the same tree with the collected profile (AMM_PGO=USE).
+#
+# usage: tools/pgo_build.sh [-B build-dir] [-c session.cap] [-n events] [-- extra cmake arguments]
+set -e
+
+BUILD=build-pgo
+CAPTURE=
+EVENTS=200000
+while [ $# -gt 0 ]; do
+    case "$1" in
+        -B) BUILD=$2; shift 2 ;;
+        -c) CAPTURE=$(cd "$(dirname "$2")" && pwd)/$(basename "$2"); shift 2 ;;
+        -n) EVENTS=$2; shift 2 ;;
+        --) shift; break ;;
+        -h|--help) sed -n '2,7p' "$0"; exit 0 ;;
+        *) echo "unknown argument: $1" >&2; exit 1 ;;
+    esac
+done
+
+SOURCE=$(cd "$(dirname "$0")/.." && pwd)
+mkdir -p "$BUILD"
+BUILD=$(cd "$BUILD" && pwd)
+DATA=$BUILD/pgo-data
+JOBS=$(nproc 2>/dev/null || echo 4)
+
+echo "== Instrumented build in $BUILD"
+rm -rf "$DATA"
+cmake -S "$SOURCE" -B "$BUILD" -DCMAKE_BUILD_TYPE=Release -DAMM_PGO=GENERATE -DAMM_PGO_DATA="$DATA" \
+      -DAMM_BUILD_BENCHMARKS=ON -DAMM_BUILD_TOOLS=ON "$@"
+cmake --build "$BUILD" -j"$JOBS"
+
+echo "== Training on the ingest benchmark"
+TRAIN=$BUILD/pgo-train
+rm -rf "$TRAIN" && mkdir -p "$TRAIN"
+"$BUILD/bin/amm_ingest_benchmark" -n "$EVENTS" -m 16 -d "$TRAIN"
+
+if [ -n "$CAPTURE" ]; then
+    echo "== Training on $CAPTURE"
+    cd "$BUILD/bin"
+    ./amm_module_manager -a -s -w &
+    MANAGER=$!
+    sleep 2
+    ./amm_bus_replay "$CAPTURE" -x max -l 3 || true
+    # The manager only writes its profile when it exits normally.
+    kill -TERM "$MANAGER"
+    wait "$MANAGER" || true
+    cd - >/dev/null
+fi
+
+if ls "$DATA"/*.profraw >/dev/null 2>&1; then
+    llvm-profdata merge -o "$DATA/default.profdata" "$DATA"/*.profraw
+fi
+
+echo "== Optimized build"
+cmake -S "$SOURCE" -B "$BUILD" -DAMM_PGO=USE
+cmake --build "$BUILD" -j"$JOBS"
+echo "== $BUILD/bin/amm_module_manager is built with the profile in $DATA"